@@ -1,23 +1,47 @@
-cirCmd.o: cirCmd.cpp cirMgr.h cirGate.h ../../include/myHash.h \
+cirCheckpoint.o: cirCheckpoint.cpp cirCheckpoint.h cirMgr.h cirGate.h \
+ cirSimGen.h cirSimLog.h cirPattern.h cirCut.h ../../include/myHash.h \
+ ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
+ ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
+ ../../include/Proof.h ../../include/File.h
+cirCmd.o: cirCmd.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
  ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
  ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
  ../../include/Proof.h ../../include/File.h cirCmd.h \
  ../../include/cmdParser.h ../../include/cmdCharDef.h \
  ../../include/util.h ../../include/rnGen.h ../../include/myUsage.h
-cirFraig.o: cirFraig.cpp cirMgr.h cirGate.h ../../include/myHash.h \
+cirCut.o: cirCut.cpp cirCut.h cirGate.h
+cirFraig.o: cirFraig.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
+ ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
+ ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
+ ../../include/Proof.h ../../include/File.h
+cirFraigPar.o: cirFraigPar.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
+ ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
+ ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
+ ../../include/Proof.h ../../include/File.h
+cirFraigPart.o: cirFraigPart.cpp cirMgr.h cirGate.h cirSimGen.h \
+ cirSimLog.h cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
  ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
  ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
  ../../include/Proof.h ../../include/File.h
-cirGate.o: cirGate.cpp cirMgr.h cirGate.h ../../include/myHash.h \
+cirGate.o: cirGate.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
  ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
  ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
  ../../include/Proof.h ../../include/File.h ../../include/util.h \
  ../../include/rnGen.h ../../include/myUsage.h
-cirMgr.o: cirMgr.cpp cirMgr.h cirGate.h ../../include/myHash.h \
+cirMgr.o: cirMgr.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
  ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
  ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
  ../../include/Proof.h ../../include/File.h
-cirSim.o: cirSim.cpp cirMgr.h cirGate.h ../../include/myHash.h \
+cirPattern.o: cirPattern.cpp cirPattern.h cirGate.h
+cirSim.o: cirSim.cpp cirMgr.h cirGate.h cirSimGen.h cirSimLog.h \
+ cirPattern.h cirCut.h cirCheckpoint.h ../../include/myHash.h \
  ../../include/sat.h ../../include/Solver.h ../../include/SolverTypes.h \
  ../../include/Global.h ../../include/VarOrder.h ../../include/Heap.h \
  ../../include/Proof.h ../../include/File.h
+cirSimGen.o: cirSimGen.cpp cirSimGen.h cirGate.h
+cirSimLog.o: cirSimLog.cpp cirSimLog.h cirGate.h cirPattern.h
@@ -0,0 +1,307 @@
+/****************************************************************************
+  FileName     [ cirCheckpoint.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define fraig checkpoint snapshots and their writer ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cstdio>
+#include <cassert>
+#include <fstream>
+#include "cirCheckpoint.h"
+#include "cirMgr.h"
+#include "cirGate.h"
+
+using namespace std;
+
+/***************************************/
+/*   struct CirCheckpoint              */
+/***************************************/
+// to file.tmp, then renamed over file: a crash while writing leaves the
+// previous checkpoint intact
+bool CirCheckpoint::write() const {
+   string tmp = file + ".tmp";
+   FILE *fp = fopen(tmp.c_str(), "w");
+   if(!fp) {
+      fprintf(stderr, "Error: cannot write checkpoint \"%s\"!!\n",
+            tmp.c_str());
+      return false;
+   }
+
+   fprintf(fp, "aag %d %d 0 %d %d\n", maxvar, (int)pis.size(),
+         (int)pos.size(), (int)ands.size()/3);
+   for(int i = 0, n = pis.size(); i < n; ++i)
+      fprintf(fp, "%d\n", pis[i]*2);
+   for(int i = 0, n = pos.size(); i < n; ++i)
+      fprintf(fp, "%d\n", pos[i]);
+   for(int i = 0, n = ands.size(); i < n; i += 3)
+      fprintf(fp, "%d %d %d\n", ands[i]*2, ands[i+1], ands[i+2]);
+   for(int i = 0, n = pi_syms.size(); i < n; ++i)
+      fprintf(fp, "i%d %s\n", pi_syms[i].first, pi_syms[i].second.c_str());
+   for(int i = 0, n = po_syms.size(); i < n; ++i)
+      fprintf(fp, "o%d %s\n", po_syms[i].first, po_syms[i].second.c_str());
+
+   fprintf(fp, "c\nfraig checkpoint 1\neffort %d\n", effort);
+   fprintf(fp, "fec %d\n", nfec);
+   for(int i = 0, n = fec.size(); i < n; ) {
+      int m = fec[i++];
+      fprintf(fp, "%d", m);
+      for(int j = 0; j < m; ++j)
+         fprintf(fp, " %d", fec[i++]);
+      fprintf(fp, "\n");
+   }
+   fprintf(fp, "blacklist %d\n", (int)blacklist.size());
+   for(int i = 0, n = blacklist.size(); i < n; ++i)
+      fprintf(fp, "%d %d\n", blacklist[i].first, blacklist[i].second);
+   fprintf(fp, "patterns %d\n", (int)patts.size());
+   for(int i = 0, n = patts.size(); i < n; ++i)
+      fprintf(fp, "%s\n", patts[i].c_str());
+   fprintf(fp, "end\n");
+
+   bool ok = !ferror(fp);
+   if(fclose(fp) != 0) ok = false;
+   if(!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+      fprintf(stderr, "Error: cannot write checkpoint \"%s\"!!\n",
+            file.c_str());
+      return false;
+   }
+   return true;
+}
+
+/***************************************/
+/*   class CirCheckpointWriter         */
+/***************************************/
+CirCheckpointWriter::CirCheckpointWriter() {
+   stop = busy = false;
+   pending = NULL;
+
+   pthread_mutex_init(&mutex, NULL);
+   pthread_cond_init(&cond, NULL);
+   threaded = (pthread_create(&thread, NULL, threadMain, this) == 0);
+   if(!threaded) {
+      // no thread, write synchronously
+      pthread_mutex_destroy(&mutex);
+      pthread_cond_destroy(&cond);
+   }
+}
+
+CirCheckpointWriter::~CirCheckpointWriter() {
+   flush();
+
+   if(threaded) {
+      pthread_mutex_lock(&mutex);
+      stop = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      pthread_join(thread, NULL);
+      pthread_mutex_destroy(&mutex);
+      pthread_cond_destroy(&cond);
+   }
+}
+
+void *CirCheckpointWriter::threadMain(void *arg) {
+   CirCheckpointWriter *w = (CirCheckpointWriter *)arg;
+
+   pthread_mutex_lock(&w->mutex);
+   for(;;) {
+      while(!w->pending && !w->stop)
+         pthread_cond_wait(&w->cond, &w->mutex);
+      if(!w->pending) break;
+
+      CirCheckpoint *c = w->pending;
+      w->pending = NULL;
+      w->busy = true;
+      pthread_mutex_unlock(&w->mutex);
+
+      c->write();
+      delete c;
+
+      pthread_mutex_lock(&w->mutex);
+      w->busy = false;
+      pthread_cond_broadcast(&w->cond);
+   }
+   pthread_mutex_unlock(&w->mutex);
+   return NULL;
+}
+
+void CirCheckpointWriter::post(CirCheckpoint *c) {
+   if(!threaded) {
+      c->write();
+      delete c;
+      return;
+   }
+
+   pthread_mutex_lock(&mutex);
+   // superseded before it was started
+   if(pending) delete pending;
+   pending = c;
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+}
+
+void CirCheckpointWriter::flush() {
+   if(!threaded) return;
+
+   pthread_mutex_lock(&mutex);
+   while(pending || busy)
+      pthread_cond_wait(&cond, &mutex);
+   pthread_mutex_unlock(&mutex);
+}
+
+/*******************************************/
+/*   class CirMgr member functions: fraig  */
+/*******************************************/
+// snapshot of the netlist and the fraig state for the writer; at most
+// once per fraig_ckpt_interval seconds unless forced. with eqlit (in the
+// middle of a sweep) gates merged away are left out and fanins are
+// written as what they resolve to.
+void CirMgr::fraigCheckpoint(bool force, const int *eqlit) {
+   if(!fraig_ckpt) return;
+
+   double now = wallClockMs();
+   if(!force && now - fraig_ckpt_last < fraig_ckpt_interval*1000.0)
+      return;
+   fraig_ckpt_last = now;
+
+   CirCheckpoint *c = new CirCheckpoint;
+   c->file = fraig_ckpt_file;
+   c->maxvar = nMaxVar;
+
+   for(int i = 0; i < nInputs; ++i) {
+      c->pis.push_back(inputs[i]->getVarId());
+      if(inputs[i]->hasSymbol())
+         c->pi_syms.push_back(make_pair(i, inputs[i]->getSymbol()));
+   }
+   for(int i = 0; i < nOutputs; ++i) {
+      int in0 = outputs[i]->getIN0();
+      c->pos.push_back(eqlit ? fraigResolveLit(eqlit, in0) : in0);
+      if(outputs[i]->hasSymbol())
+         c->po_syms.push_back(make_pair(i, outputs[i]->getSymbol()));
+   }
+   for(int i = 0; i < nGates; ++i) {
+      const CirVar *g = gates[i];
+      if(g->isRemoved() || g->getType() != AIG_GATE) continue;
+      int id = g->getVarId(), in0 = g->getIN0(), in1 = g->getIN1();
+      if(eqlit) {
+         if((eqlit[id]>>1) != id) continue;
+         in0 = fraigResolveLit(eqlit, in0);
+         in1 = fraigResolveLit(eqlit, in1);
+      }
+      c->ands.push_back(id);
+      c->ands.push_back(in0);
+      c->ands.push_back(in1);
+   }
+
+   // groups still list members cleanup has removed since
+   c->effort = sat_effort;
+   c->nfec = 0;
+   for(int i = 0, n = fec_groups ? fec_groups->size() : 0; i < n; ++i) {
+      const vector<int> *s = fec_groups->at(i);
+      int pos = c->fec.size();
+      c->fec.push_back(0);
+      for(int j = 0, sz = s->size(); j < sz; ++j) {
+         int id = s->at(j)>>1;
+         if(id != 0 && (vars[id]->isRemoved() ||
+                  (eqlit && (eqlit[id]>>1) != id)))
+            continue;
+         c->fec.push_back(s->at(j));
+      }
+      if((int)c->fec.size() - pos - 1 < 2) {
+         c->fec.resize(pos);
+         continue;
+      }
+      c->fec[pos] = c->fec.size() - pos - 1;
+      c->nfec++;
+   }
+   fraig_blacklist.getPairs(c->blacklist);
+   c->patts = sim_keep_patts;
+
+   printf("fraig: checkpoint to %s\n", fraig_ckpt_file.c_str());
+   fraig_ckpt->post(c);
+}
+
+// the fraig state in the comment section of a checkpoint the parser has
+// just read the netlist of
+bool CirMgr::fraigLoadCheckpoint(const string &fileName) {
+   ifstream ifs(fileName.c_str());
+   string line;
+   while(getline(ifs, line) && line != "c") ;
+   if(!getline(ifs, line) || line != "fraig checkpoint 1") {
+      fprintf(stderr, "Error: \"%s\" is not a fraig checkpoint!!\n",
+            fileName.c_str());
+      return false;
+   }
+
+   string tag;
+   int effort = EFFORT_MED, n = 0;
+   ifs >> tag >> effort;
+   if(tag != "effort" || effort < EFFORT_LOW || effort > EFFORT_UNLIMITED)
+      return fraigCheckpointError(fileName);
+   setSatEffort((SATSolveEffort)effort);
+
+   ifs >> tag >> n;
+   if(tag != "fec" || n < 0) return fraigCheckpointError(fileName);
+
+   if(!fec_groups) fec_groups = new FECGrp();
+   for(int i = 0; i <= nMaxVar; ++i)
+      vars[i]->setFecGroupId(-1);
+
+   for(int i = 0; i < n; ++i) {
+      int m = 0;
+      if(!(ifs >> m) || m < 0) return fraigCheckpointError(fileName);
+
+      // gates merged away by the parser's trivial merging drop out
+      vector<int> *s = new vector<int>();
+      for(int j = 0; j < m; ++j) {
+         int lit = -1;
+         if(!(ifs >> lit) || lit < 0 || (lit>>1) > nMaxVar) {
+            delete s;
+            return fraigCheckpointError(fileName);
+         }
+         const CirVar *v = vars[lit>>1];
+         if((lit>>1) == 0 ||
+               (v->getType() == AIG_GATE && !v->isRemoved()))
+            s->push_back(lit);
+      }
+      if(s->size() < 2) {
+         delete s;
+         continue;
+      }
+
+      int gid = fec_groups->size();
+      for(int j = 0, sz = s->size(); j < sz; ++j)
+         vars[s->at(j)>>1]->setFecGroup(gid, s->at(j));
+      fec_groups->push_back(s);
+   }
+
+   ifs >> tag >> n;
+   if(tag != "blacklist" || n < 0) return fraigCheckpointError(fileName);
+   for(int i = 0; i < n; ++i) {
+      int a, b;
+      if(!(ifs >> a >> b)) return fraigCheckpointError(fileName);
+      fraig_blacklist.insert(a, b);
+   }
+
+   ifs >> tag >> n;
+   if(tag != "patterns" || n < 0) return fraigCheckpointError(fileName);
+   for(int i = 0; i < n; ++i) {
+      if(!(ifs >> line) || (int)line.size() != nInputs)
+         return fraigCheckpointError(fileName);
+      keepSimulationPattern(line.c_str());
+   }
+
+   ifs >> tag;
+   if(tag != "end") return fraigCheckpointError(fileName);
+
+   printf("fraig: resumed from %s, %d FEC groups, %d pairs blacklisted\n",
+         fileName.c_str(), (int)fec_groups->size(),
+         (int)fraig_blacklist.size());
+   return true;
+}
+
+bool CirMgr::fraigCheckpointError(const string &fileName) {
+   fprintf(stderr, "Error: corrupted fraig checkpoint \"%s\"!!\n",
+         fileName.c_str());
+   return false;
+}
@@ -0,0 +1,79 @@
+/****************************************************************************
+  FileName     [ cirCheckpoint.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define fraig checkpoint snapshots and their writer ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_CHECKPOINT_H
+#define CIR_CHECKPOINT_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+// A checkpoint is an AAG file: the netlist as CIRWrite would write it,
+// with the fraig state in the comment section:
+//
+//    c
+//    fraig checkpoint 1
+//    effort <SATSolveEffort>
+//    fec <#groups>
+//    <#members> <lit> ...           one line per group
+//    blacklist <#pairs>
+//    <var> <var>                    one line per pair
+//    patterns <#patterns>
+//    <'0'/'1' per PI>               one line per pattern
+//    end
+//
+// so any AIG reader takes it as the circuit fraig has reached.
+
+// state copied out of CirMgr in one go; formatting and I/O happen on the
+// writer thread
+struct CirCheckpoint
+{
+   string file;
+
+   int maxvar;
+   vector<int> pis;                 // var ids
+   vector<int> pos;                 // literals
+   vector<int> ands;                // var id, in0, in1 per live gate
+   vector<pair<int, string> > pi_syms, po_syms;
+
+   int effort;
+   vector<int> fec;                 // #members then the members
+   int nfec;
+   vector<pair<int, int> > blacklist;
+   vector<string> patts;
+
+   bool write() const;
+};
+
+// writes checkpoints on a background thread. a snapshot posted while the
+// previous one is still being written waits; one posted before that
+// waiting one was picked up replaces it, so post() never blocks on I/O.
+class CirCheckpointWriter
+{
+public:
+   CirCheckpointWriter();
+   ~CirCheckpointWriter();
+
+   // takes ownership of c
+   void post(CirCheckpoint *c);
+   // wait until everything posted is on disk
+   void flush();
+
+private:
+   bool threaded, stop, busy;
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   CirCheckpoint *pending;
+
+   static void *threadMain(void *arg);
+};
+
+#endif // CIR_CHECKPOINT_H
@@ -7,11 +7,13 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <climits>
 #include <iostream>
 #include <iomanip>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "cirCmd.h"
+#include "cirPattern.h"
 #include "util.h"
 
 using namespace std;
@@ -28,7 +30,8 @@ initCirCmd()
          cmdMgr->regCmd("CIRSIMulate", 6, new CirSimCmd) &&
          cmdMgr->regCmd("CIRFraig", 4, new CirFraigCmd) &&
          cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd) &&
-         cmdMgr->regCmd("CIRSAT", 6, new CirSatCmd)
+         cmdMgr->regCmd("CIRSAT", 6, new CirSatCmd) &&
+         cmdMgr->regCmd("CIRPATConvert", 6, new CirPatConvertCmd)
       )) {
       cerr << "Registering \"cir\" commands fails... exiting" << endl;
       return false;
@@ -296,8 +299,12 @@ CirStrashCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRSIMulate <-Random | -File <string patternFile>>
-//                [-Output (string logFile)]
+//    CIRSIMulate <-Random [-Seed (int seed)] [-Bias (int pct) | -FLip]
+//                         [-Time (int msec)] [-Patterns (int n)]
+//                 | -File <string patternFile> | -Exhaustive>
+//                [-Output (string logFile) [-Async]] [-Words (int sigWords)]
+//                [-NoFEC] [-Corpus (string corpusFile)]
+//                [-SAveCorpus (string corpusFile)]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirSimCmd::exec(const string& option)
@@ -310,17 +317,20 @@ CirSimCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   ifstream patternFile;
+   ifstream patternFile, corpusFile;
    ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   string saveCorpus;
+   bool doRandom = false, doFile = false, doLog = false, doExh = false;
+   int sigWords = 0, seed = -1, biasPct = -1, timeBudget = 0, pattBudget = 0;
+   bool doFlip = false, doAsync = false, noFec = false;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Random", options[i], 2) == 0) {
-         if (doRandom || doFile)
+         if (doRandom || doFile || doExh)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          doRandom = true;
       }
       else if (myStrNCmp("-File", options[i], 2) == 0) {
-         if (doRandom || doFile)
+         if (doRandom || doFile || doExh)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
@@ -329,6 +339,27 @@ CirSimCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
          doFile = true;
       }
+      else if (myStrNCmp("-Corpus", options[i], 2) == 0) {
+         if (corpusFile.is_open())
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         corpusFile.open(options[i].c_str(), ios::in);
+         if (!corpusFile)
+            return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
+      }
+      else if (myStrNCmp("-SAveCorpus", options[i], 3) == 0) {
+         if (!saveCorpus.empty())
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         saveCorpus = options[i];
+      }
+      else if (myStrNCmp("-Exhaustive", options[i], 2) == 0) {
+         if (doRandom || doFile || doExh)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doExh = true;
+      }
       else if (myStrNCmp("-Output", options[i], 2) == 0) {
          if (doLog)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -339,23 +370,123 @@ CirSimCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[i]);
          doLog = true;
       }
+      else if (myStrNCmp("-NoFEC", options[i], 3) == 0) {
+         if (noFec)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         noFec = true;
+      }
+      else if (myStrNCmp("-Async", options[i], 2) == 0) {
+         if (doAsync)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doAsync = true;
+      }
+      else if (myStrNCmp("-Seed", options[i], 2) == 0) {
+         if (seed >= 0)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], seed) || seed < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Bias", options[i], 2) == 0) {
+         if (biasPct >= 0 || doFlip)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], biasPct) || biasPct < 0 || biasPct > 100)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-FLip", options[i], 3) == 0) {
+         if (biasPct >= 0 || doFlip)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doFlip = true;
+      }
+      else if (myStrNCmp("-Time", options[i], 2) == 0) {
+         if (timeBudget)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], timeBudget) || timeBudget <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Patterns", options[i], 2) == 0) {
+         if (pattBudget)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], pattBudget) || pattBudget <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Words", options[i], 2) == 0) {
+         if (sigWords)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], sigWords) || sigWords <= 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
-   if (!doRandom && !doFile)
+   if (!doRandom && !doFile && !doExh && !corpusFile.is_open())
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   if (!doRandom && (seed >= 0 || biasPct >= 0 || doFlip ||
+         timeBudget || pattBudget)) {
+      cerr << "Error: -Seed/-Bias/-FLip/-Time/-Patterns apply to -Random "
+           << "only!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+
+   if (noFec && doExh) {
+      cerr << "Error: -Exhaustive builds exact FEC groups, it cannot be "
+           << "used with -NoFEC!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   if (noFec && doRandom && !timeBudget && !pattBudget) {
+      cerr << "Error: -Random -NoFEC needs -Time or -Patterns!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   if (doAsync && !doLog) {
+      cerr << "Error: -Async applies to -Output only!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
 
    assert (curCmd != CIRINIT);
    if (doLog)
-      cirMgr->setSimLog(&logFile);
+      cirMgr->setSimLog(&logFile, doAsync);
    else cirMgr->setSimLog(0);
-
-   if (doRandom)
+   if (sigWords)
+      cirMgr->setSimSignatureWords(sigWords);
+   cirMgr->setSimNoFec(noFec);
+   if (!saveCorpus.empty() && !cirMgr->setSimCorpus(saveCorpus))
+      return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, saveCorpus);
+
+   // replay a saved corpus first, the rest refines from there
+   if (corpusFile.is_open())
+      cirMgr->fileSim(corpusFile);
+
+   if (doRandom) {
+      if (seed >= 0)
+         cirMgr->setSimSeed(seed);
+      if (biasPct >= 0)
+         cirMgr->setSimPatternGen(SIMGEN_BIASED, biasPct * 256 / 100);
+      else if (doFlip)
+         cirMgr->setSimPatternGen(SIMGEN_FLIP);
+      else
+         cirMgr->setSimPatternGen(SIMGEN_RANDOM);
+      cirMgr->setSimBudget(timeBudget, pattBudget);
       cirMgr->randomSim();
-   else
+   }
+   else if (doExh) {
+      if (!cirMgr->exhaustiveSim())
+         return CMD_EXEC_ERROR;
+   }
+   else if (doFile)
       cirMgr->fileSim(patternFile);
-   curCmd = CIRSIMULATE;
+   // responses only, the circuit is not partitioned for fraig
+   if (!noFec)
+      curCmd = CIRSIMULATE;
    
    return CMD_EXEC_DONE;
 }
@@ -363,8 +494,17 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>"
-      << "                   [-Output (string logFile)]" << endl;
+   os << "Usage: CIRSIMulate <-Random [-Seed (int seed)]"
+      << " [-Bias (int pct) | -FLip]" << endl
+      << "                            [-Time (int msec)]"
+      << " [-Patterns (int n)]" << endl
+      << "                    | -File <string patternFile> | -Exhaustive>"
+      << endl
+      << "                   [-Output (string logFile) [-Async]]"
+      << " [-Words (int sigWords)]" << endl
+      << "                   [-NoFEC] [-Corpus (string corpusFile)]"
+      << endl
+      << "                   [-SAveCorpus (string corpusFile)]" << endl;
 }
 
 void
@@ -375,26 +515,167 @@ CirSimCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRFraig
+//    CIRFraig [-FLip] [-SWeep] [-Threads (int n)] [-Patterns (int n)]
+//             [-PARtition (int gates)]
+//             [-CHeckpoint (string file) [-INTerval (int sec)]]
+//             [-Resume (string file)] [-TIme (int sec)] [-Mem (int MB)]
+//             [-Output (int poIdx)...] [-Gate (int gateId)...]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirFraigCmd::exec(const string& option)
 {
-   if (!cirMgr) {
-      cerr << "Error: circuit is not yet constructed!!" << endl;
-      return CMD_EXEC_ERROR;
-   }
    // check option
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   bool doFlip = false, doSweep = false;
+   int threads = 0, patterns = 0, partition = 0, interval = 0;
+   int timeLimit = 0, memLimit = 0;
+   string ckptFile, resumeFile;
+   vector<int> scopePos, scopeGates;
+   for (size_t i = 0, n = options.size(); i < n; ++i) {
+      if (myStrNCmp("-FLip", options[i], 3) == 0) {
+         if (doFlip)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doFlip = true;
+      }
+      else if (myStrNCmp("-SWeep", options[i], 3) == 0) {
+         if (doSweep)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         doSweep = true;
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (threads)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], threads) || threads < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-PARtition", options[i], 4) == 0) {
+         if (partition)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], partition) || partition < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Patterns", options[i], 2) == 0) {
+         if (patterns)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], patterns) || patterns < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-CHeckpoint", options[i], 3) == 0) {
+         if (ckptFile.size())
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         ckptFile = options[i];
+      }
+      else if (myStrNCmp("-INTerval", options[i], 4) == 0) {
+         if (interval)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], interval) || interval < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Resume", options[i], 2) == 0) {
+         if (resumeFile.size())
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         resumeFile = options[i];
+      }
+      else if (myStrNCmp("-TIme", options[i], 3) == 0) {
+         if (timeLimit)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         // the limit is kept in msec
+         if (!myStr2Int(options[i], timeLimit) || timeLimit < 1 ||
+               timeLimit > INT_MAX / 1000)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Mem", options[i], 2) == 0) {
+         if (memLimit)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], memLimit) || memLimit < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+      }
+      else if (myStrNCmp("-Output", options[i], 2) == 0 ||
+               myStrNCmp("-Gate", options[i], 2) == 0) {
+         // ids up to the next option
+         vector<int> &ids = (myStrNCmp("-Output", options[i], 2) == 0) ?
+            scopePos : scopeGates;
+         size_t first = i;
+         int id;
+         while (i+1 < n && options[i+1][0] != '-') {
+            if (!myStr2Int(options[++i], id) || id < 0)
+               return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+            ids.push_back(id);
+         }
+         if (i == first)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i]);
+      }
+      else
+         return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+   }
+   if (interval && ckptFile.empty())
+      return CmdExec::errorOption(CMD_OPT_MISSING, "-CHeckpoint");
+   bool scoped = scopePos.size() || scopeGates.size();
+   if (scoped && partition) {
+      cerr << "Error: -PARtition cannot be scoped!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
 
-   if (curCmd != CIRSIMULATE) {
+   // the checkpoint replaces whatever circuit there is; its FEC groups
+   // stand in for simulation
+   if (resumeFile.size()) {
+      CirMgr *mgr = new CirMgr;
+      if (!mgr->readCircuit(resumeFile) ||
+            !mgr->fraigLoadCheckpoint(resumeFile)) {
+         delete mgr;
+         return CMD_EXEC_ERROR;
+      }
+      if (cirMgr) {
+         cerr << "Note: original circuit is replaced..." << endl;
+         delete cirMgr;
+      }
+      cirMgr = mgr;
+   }
+   else if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // partitions and scopes are simulated on their own
+   else if (curCmd != CIRSIMULATE && !partition && !scoped) {
       cerr << "Error: circuit is not yet simulated!!" << endl;
       return CMD_EXEC_ERROR;
    }
+
+   // PO i is gate id M+1+i
+   for (size_t i = 0; i < scopePos.size(); ++i) {
+      if (scopePos[i] >= cirMgr->getNumPOs()) {
+         cerr << "Error: PO(" << scopePos[i] << ") not found!!" << endl;
+         return CMD_EXEC_ERROR;
+      }
+      scopeGates.push_back(cirMgr->getMaxVarNum() + 1 + scopePos[i]);
+   }
+   if (!cirMgr->setFraigScope(scopeGates))
+      return CMD_EXEC_ERROR;
+   cirMgr->setFraigCheckpoint(ckptFile, interval ? interval : 60);
+   cirMgr->setFraigLimits(timeLimit*1000, memLimit);
+   cirMgr->setFraigCexFlip(doFlip);
+   cirMgr->setFraigSweep(doSweep);
+   cirMgr->setFraigPartition(partition);
+   cirMgr->setFraigThreads(threads ? threads : 1);
+   if (patterns) cirMgr->setFraigKeyPatterns(patterns);
    cirMgr->fraig();
    curCmd = CIRFRAIG;
 
@@ -404,7 +685,15 @@ CirFraigCmd::exec(const string& option)
 void
 CirFraigCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRFraig" << endl;
+   os << "Usage: CIRFraig [-FLip] [-SWeep] [-Threads (int n)]"
+      << " [-Patterns (int n)]" << endl
+      << "                [-PARtition (int gates)]" << endl
+      << "                [-CHeckpoint (string file) [-INTerval (int sec)]]"
+      << endl
+      << "                [-Resume (string file)] [-TIme (int sec)]"
+      << " [-Mem (int MB)]" << endl
+      << "                [-Output (int poIdx)...] [-Gate (int gateId)...]"
+      << endl;
 }
 
 void
@@ -510,3 +799,39 @@ CirSatCmd::help() const
         << "set the proof effort limits for the SAT engine" << endl;
 }
 
+
+//----------------------------------------------------------------------
+//    CIRPATConvert <(string textFile)> <(string binFile)>
+//----------------------------------------------------------------------
+CmdExecStatus
+CirPatConvertCmd::exec(const string& option)
+{
+   // check option
+   vector<string> options;
+   if (!CmdExec::lexOptions(option, options))
+      return CMD_EXEC_ERROR;
+   if (options.size() < 2)
+      return CmdExec::errorOption(CMD_OPT_MISSING,
+            options.empty() ? "" : options[0]);
+   if (options.size() > 2)
+      return CmdExec::errorOption(CMD_OPT_EXTRA, options[2]);
+
+   if (!packPatternFile(options[0].c_str(), options[1].c_str()))
+      return CMD_EXEC_ERROR;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirPatConvertCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRPATConvert <(string textFile)> <(string binFile)>"
+      << endl;
+}
+
+void
+CirPatConvertCmd::help() const
+{
+   cout << setw(15) << left << "CIRPATConvert: "
+        << "pack a text pattern file into the binary pattern format" << endl;
+}
@@ -19,5 +19,6 @@ CmdClass(CirSimCmd);
 CmdClass(CirFraigCmd);
 CmdClass(CirWriteCmd);
 CmdClass(CirSatCmd);
+CmdClass(CirPatConvertCmd);
 
 #endif // CIR_CMD_H
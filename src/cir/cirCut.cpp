@@ -0,0 +1,170 @@
+/****************************************************************************
+  FileName     [ cirCut.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define k-feasible cut enumeration ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cassert>
+#include "cirCut.h"
+
+using namespace std;
+
+/*******************************/
+/*   struct CirCut             */
+/*******************************/
+bool CirCut::sameLeaves(const CirCut &c) const {
+   if(nleaves != c.nleaves || sign != c.sign) return false;
+   for(int i = 0; i < nleaves; ++i)
+      if(leaves[i] != c.leaves[i]) return false;
+   return true;
+}
+
+bool CirCut::subsetOf(const CirCut &c) const {
+   if(nleaves > c.nleaves || (sign & ~c.sign)) return false;
+   for(int i = 0, j = 0; i < nleaves; ++i, ++j) {
+      int l = leaves[i];
+      while(j < c.nleaves && c.leaves[j] < l) ++j;
+      if(j == c.nleaves || c.leaves[j] != l) return false;
+   }
+   return true;
+}
+
+/*******************************/
+/*   class CirCutMgr           */
+/*******************************/
+uint64_t CirCutMgr::varTruth(int i) {
+   static const uint64_t t[CIR_CUT_K_MAX] = {
+      0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+      0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+   };
+   return t[i];
+}
+
+void CirCutMgr::init(CirVar *const *vars, int nvars, int k, int max_cuts) {
+   assert(k >= 1 && k <= CIR_CUT_K_MAX && max_cuts >= 1);
+   reset();
+
+   this->vars = vars;
+   this->nvars = nvars;
+   this->k = k;
+   this->max_cuts = max_cuts;
+   cuts = new CirCut[(size_t)nvars*max_cuts];
+   ncuts = new int[nvars];
+   for(int i = 0; i < nvars; ++i)
+      ncuts[i] = -1;
+}
+
+void CirCutMgr::reset() {
+   if(cuts) delete[] cuts;
+   if(ncuts) delete[] ncuts;
+   cuts = NULL;
+   ncuts = NULL;
+   cand.clear();
+}
+
+const CirCut *CirCutMgr::getCuts(int varid, int &n) {
+   if(ncuts[varid] < 0) compute(varid);
+   n = ncuts[varid];
+   return cuts + (size_t)varid*max_cuts;
+}
+
+void CirCutMgr::compute(int varid) {
+   const CirVar *v = vars[varid];
+   CirCut *out = cuts + (size_t)varid*max_cuts;
+
+   if(varid == 0 || v->getType() == CONST_GATE) {
+      out[0].nleaves = 0;
+      out[0].sign = 0;
+      out[0].truth = 0;
+      ncuts[varid] = 1;
+      return;
+   }
+
+   out[0].nleaves = 1;
+   out[0].leaves[0] = varid;
+   out[0].sign = 1u << (varid & 31);
+   out[0].truth = varTruth(0);
+   ncuts[varid] = 1;
+   if(v->getType() != AIG_GATE) return;
+
+   int in0 = v->getIN0(), in1 = v->getIN1();
+   int n0, n1;
+   const CirCut *c0 = getCuts(in0>>1, n0);
+   const CirCut *c1 = getCuts(in1>>1, n1);
+   uint64_t m0 = -(uint64_t)(in0&1), m1 = -(uint64_t)(in1&1);
+
+   // every pair of fanin cuts, without the ones a smaller cut dominates
+   CirCut r;
+   cand.clear();
+   for(int i = 0; i < n0; ++i) {
+      for(int j = 0; j < n1; ++j) {
+         if(!merge(c0[i], c1[j], r)) continue;
+
+         r.truth = (stretch(c0[i].truth, c0[i], r) ^ m0) &
+                   (stretch(c1[j].truth, c1[j], r) ^ m1);
+
+         bool dominated = false;
+         for(int c = 0, sz = cand.size(); c < sz && !dominated; ++c)
+            dominated = cand[c].subsetOf(r);
+         if(dominated) continue;
+
+         for(int c = cand.size() - 1; c >= 0; --c)
+            if(r.subsetOf(cand[c])) {
+               cand[c] = cand.back();
+               cand.pop_back();
+            }
+         cand.push_back(r);
+      }
+   }
+
+   // smallest cuts first, the trivial cut is already in
+   int n = 1;
+   for(int s = 0; s <= k && n < max_cuts; ++s)
+      for(int c = 0, sz = cand.size(); c < sz && n < max_cuts; ++c)
+         if(cand[c].nleaves == s) out[n++] = cand[c];
+   ncuts[varid] = n;
+}
+
+// union of the leaves of a and b, false if more than k
+bool CirCutMgr::merge(const CirCut &a, const CirCut &b, CirCut &r) const {
+   int i = 0, j = 0, n = 0;
+   while(i < a.nleaves || j < b.nleaves) {
+      int l;
+      if(j == b.nleaves || (i < a.nleaves && a.leaves[i] < b.leaves[j]))
+         l = a.leaves[i++];
+      else if(i == a.nleaves || b.leaves[j] < a.leaves[i])
+         l = b.leaves[j++];
+      else {
+         l = a.leaves[i++];
+         j++;
+      }
+      if(n == k) return false;
+      r.leaves[n++] = l;
+   }
+   r.nleaves = n;
+   r.sign = a.sign | b.sign;
+   return true;
+}
+
+// truth table t over the leaves of from, re-expressed over the leaves of
+// to (a superset): each leaf moves up to its position in to, highest
+// first, so it always lands on a variable t does not depend on
+uint64_t CirCutMgr::stretch(uint64_t t, const CirCut &from,
+      const CirCut &to) {
+   int p = to.nleaves - 1;
+   for(int i = from.nleaves - 1; i >= 0; --i) {
+      while(to.leaves[p] != from.leaves[i]) --p;
+      if(p != i) t = swapVars(t, i, p);
+   }
+   return t;
+}
+
+// exchange variables i < j of t
+uint64_t CirCutMgr::swapVars(uint64_t t, int i, int j) {
+   uint64_t up = varTruth(i) & ~varTruth(j);
+   uint64_t down = ~varTruth(i) & varTruth(j);
+   int shift = (1 << j) - (1 << i);
+   return (t & ~(up | down)) | ((t & up) << shift) | ((t & down) >> shift);
+}
@@ -0,0 +1,72 @@
+/****************************************************************************
+  FileName     [ cirCut.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define k-feasible cut enumeration ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_CUT_H
+#define CIR_CUT_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cirGate.h"
+
+using namespace std;
+
+// a truth table over up to 6 variables fits in one word
+#define CIR_CUT_K_MAX 6
+
+// leaves in ascending var id; leaf i is variable i of the truth table.
+// vars above nleaves do not matter, the table repeats over them.
+struct CirCut
+{
+   int nleaves;
+   int leaves[CIR_CUT_K_MAX];
+   uint32_t sign;       // OR of 1 << (leaf % 32), rejects most non-subsets
+   uint64_t truth;
+
+   bool sameLeaves(const CirCut &c) const;
+   bool subsetOf(const CirCut &c) const;
+};
+
+// cuts of each var up to k leaves, at most max_cuts per var with the
+// trivial cut {var} first. cuts are computed from the fanin cuts on first
+// use and kept until invalidated; a var id always denotes the same
+// function while fraig merges, so kept cuts stay correct.
+class CirCutMgr
+{
+public:
+   CirCutMgr(): vars(NULL), nvars(0), k(0), max_cuts(0),
+      cuts(NULL), ncuts(NULL) {}
+   ~CirCutMgr() { reset(); }
+
+   void init(CirVar *const *vars, int nvars, int k, int max_cuts);
+   void reset();
+   bool isInitialized() const { return cuts != NULL; }
+
+   const CirCut *getCuts(int varid, int &n);
+   // to be recomputed from the current fanins on next use
+   void invalidate(int varid) { ncuts[varid] = -1; }
+
+   // truth table of variable i
+   static uint64_t varTruth(int i);
+   // truth table t over the leaves of from, over the leaves of to
+   static uint64_t stretch(uint64_t t, const CirCut &from,
+         const CirCut &to);
+
+private:
+   CirVar *const *vars;
+   int nvars, k, max_cuts;
+   CirCut *cuts;        // max_cuts per var
+   int *ncuts;          // -1: not computed
+   vector<CirCut> cand;
+
+   void compute(int varid);
+   bool merge(const CirCut &a, const CirCut &b, CirCut &r) const;
+   static uint64_t swapVars(uint64_t t, int i, int j);
+};
+
+#endif // CIR_CUT_H
@@ -23,6 +23,26 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// candidate pairs whose joint support has at most this many PIs are
+// decided by exhaustive simulation instead of SAT
+#define FRAIG_CONE_MAX_PI 12
+
+// pairs of one group already separated by pending counterexamples
+// before that group is resimulated early
+#define FRAIG_EARLY_RESIM 8
+
+// scheduler cost added to a representative per query against it that
+// turned out different, and per query that ran out of SAT effort
+#define FRAIG_SCHED_NEQ_COST  1
+#define FRAIG_SCHED_HARD_COST 8
+
+// cuts kept per gate for functional matching
+#define FRAIG_CUTS_PER_VAR 8
+
+// budget checks between two reads of the resident memory size
+#define FRAIG_MEM_CHECK_EVERY 256
+
+static const int W = sizeof(gateval_t)*8;
 
 /**************************************/
 /*   Static varaibles and functions   */
@@ -69,6 +89,9 @@ int CirMgr::strashDFS(bool *visited, Hash<VarHashKey, int> &h, int litid) {
 }
 
 int CirMgr::FecGrouping() {
+   // members of a refined group keep their phase; only the initial group
+   // may pair a gate with the complement of another
+   bool first = !fec_groups;
    if(!fec_groups)
       initFecGroups();
 
@@ -77,44 +100,52 @@ int CirMgr::FecGrouping() {
    // prepare a new container
    FECGrp *fec_new = new FECGrp();
 
-   // use a map to group same values
-   map<gateval_t, vector<int> *> valmap;
+   // words simulated since last refinement
+   int nwords = sim_sig_pos;
+
+   // bits of those words that split some group, for the corpus
+   gateval_t useful[nwords];
+   if(sim_corpus) memset(useful, 0, sizeof(gateval_t)*nwords);
 
    while(fec_groups->size() > 0) {
       vector<int> *s = fec_groups->back();
       fec_groups->pop_back();
 
+      // use a hash of signatures to group same values
+      Hash<SigHashKey, vector<int> *> sigmap(s->size());
+      vector<vector<int> *> conts;
+
       // eventually put gates
       for(vector<int>::iterator it = s->begin(), ed = s->end();
             it != ed; ++it) {
 
-         CirVar *v = vars[(*it)>>1];
-         if(v->isRemoved()) continue;
+         int varid = (*it)>>1;
+         if(vars[varid]->isRemoved()) continue;
 
-         map<gateval_t, vector<int> *>::iterator itmap;
+         SigHashKey k(&sim_sig[varid*sim_sig_words], nwords,
+               (*it)&1, first);
+         int lit = (varid<<1)|(k.isInverted()?1:0);
+         vector<int> *cont;
 
-         if((itmap = valmap.find(v->evaluate())) != valmap.end()) {
-            // fec eq
-            itmap->second->push_back(v->getVarId()<<1);
-         }
-         else if((itmap = valmap.find(~v->evaluate())) != valmap.end()) {
-            // fec inverted
-            itmap->second->push_back((v->getVarId()<<1)|1);
-         }
-         else {
+         if(sigmap.check(k, cont)) {
+            // fec eq or inverted, fixed relative to the first member below
+            cont->push_back(lit);
+         } else {
             // not exist pattern
-            vector<int> *cont = new vector<int>();
-            cont->push_back(v->getVarId()<<1);
+            cont = new vector<int>();
+            cont->push_back(lit);
 
-            valmap.insert(make_pair(v->evaluate(), cont));
+            sigmap.forceInsert(k, cont);
+            conts.push_back(cont);
          }
       }
 
-      // grab groups we interest in
-      for(map<gateval_t, vector<int> *>::iterator it = valmap.begin(),
-            ed = valmap.end(); it != ed; ++it) {
+      if(sim_corpus && conts.size() > 1)
+         markSplittingPatterns(conts, nwords, useful);
 
-         vector<int> *cont = it->second;
+      // grab groups we interest in
+      for(int c = 0, nc = conts.size(); c < nc; ++c) {
+         vector<int> *cont = conts[c];
 
          assert(cont->size() > 0);
          if(cont->size() == 1) {
@@ -127,6 +158,11 @@ int CirMgr::FecGrouping() {
             // add them to global group pool
             int gid = fec_new->size();
 
+            // phases relative to the first member
+            if(cont->at(0)&1)
+               for(int i = 0, n = cont->size(); i < n; ++i)
+                  cont->at(i) ^= 1;
+
             // yah, I have group id now :)
             for(int i = 0, n = cont->size(); i < n; ++i)
                vars[cont->at(i)>>1]->setFecGroup(gid, cont->at(i));
@@ -136,9 +172,10 @@ int CirMgr::FecGrouping() {
       }
 
       delete s;
-      valmap.clear();
    }
 
+   if(sim_corpus) saveSplittingPatterns(useful, nwords);
+
    // swap over
    for(int i = 0, n = fec_groups->size(); i < n; ++i)
       delete fec_groups->at(i);
@@ -162,6 +199,10 @@ void CirMgr::initFecGroups() {
    vector<int> *s = new vector<int>();
 
    for(int i = 0; i < nGates; ++i) {
+      if(fec_scope && !fec_scope[gates[i]->getVarId()]) {
+         gates[i]->setFecGroupId(-1);
+         continue;
+      }
       s->push_back(gates[i]->getVarId()<<1);
       gates[i]->setFecGroupId(0);
    }
@@ -190,62 +231,259 @@ void CirMgr::printFecGroups() {
 void
 CirMgr::fraig()
 {
+   fraig_stopped = false;
+   fraig_limit_tick = 0;
+   fraig_deadline = (fraig_time_limit > 0) ?
+      wallClockMs() + fraig_time_limit : 0.0;
+
+   // a scope not simulated yet is simulated over its cone only
+   if(!fraig_scope.empty()) {
+      fraigScopeInit();
+      if(!fec_groups) randomSim();
+   }
+
+   // each cluster is simulated and fraiged as a circuit of its own
+   if(fraig_part_gates > 0 && !fec_scope) {
+      fraigPartitioned();
+      return;
+   }
+
    if(!fec_groups)
       initFecGroups();
 
-   bool visited[nMaxVar+1];
-   memset(visited, 0, sizeof(bool)*(nMaxVar+1));
+   // 0: not visited, 1: on the DFS stack, 2: done
+   char visited[nMaxVar+1];
+
+   fraig_cone_val = new gateval_t[nMaxVar+1];
+   fraig_cone_mark = new int[nMaxVar+1];
+   memset(fraig_cone_mark, 0, sizeof(int)*(nMaxVar+1));
+   fraig_cone_stamp = 0;
+   fraigStrashInit();
+   fraig_pi_pos = new int[nMaxVar+1];
+   for(int i = 0; i < nInputs; ++i)
+      fraig_pi_pos[inputs[i]->getVarId()] = i;
+   fraig_level = new int[nMaxVar+1];
+   memset(fraig_level, 0, sizeof(int)*(nMaxVar+1));
+   fraig_sched_cost = new int[nMaxVar+1];
+   memset(fraig_sched_cost, 0, sizeof(int)*(nMaxVar+1));
+   fraig_cuts.init(vars, nMaxVar+1, CIR_CUT_K_MAX, FRAIG_CUTS_PER_VAR);
+   fraig_cut_proved = fraig_cut_refuted = 0;
 
    //fraigReducePairs();
 
    int last_fec_grp = fec_groups->size(), now_fec_grp, same_fec_counter = 0;
 
    fraig_dfs_leave = 64;
+   sat_undecided = 0;
+   // pairs out of SAT effort last time get another try
+   fraig_undecided.clear();
 
-   do {
-      sat_merged = 0;
-      fraig_sim_pairs.clear();
-
-      SatSetupInputs();
-
-      int dfn = 0;
-      int eqlit[nMaxVar+1];
+   if(!fraig_ckpt_file.empty()) {
+      fraig_ckpt = new CirCheckpointWriter();
+      fraig_ckpt_last = wallClockMs();
+   }
 
-      memset(visited, 0, sizeof(bool)*(nMaxVar+1));
+   // the bulk of the pairs goes to the workers, fraigDFS picks up what
+   // they leave (pairs against other members than the first)
+   if(fraig_threads > 1 && !fec_exact)
+      fraigParallel();
 
-      for(int i = 0; i <= nMaxVar; ++i)
-         eqlit[i] = i<<1;
+   // one solver for the whole run: gate CNF is added once, proven merges
+   // become equivalence clauses, learned clauses carry over rounds.
+   // a query running into the time limit gives up inside the solver
+   SatSetupInputs();
+   sat_solver.setDeadline(fraig_deadline);
 
-      for(int i = 0; i < nOutputs; ++i) {
-         outputs[i]->setIN0(
-               fraigDFS(dfn, visited, eqlit, outputs[i]->getIN0()));
-         if(sat_merged >= fraig_dfs_leave) break;
-      }
+   if(fraig_sweep) {
+      fraigSweep();
 
       calculateRefCount();
       mergeTrivial();
       buildRevRef();
       removeUnrefGates();
+   } else {
+      do {
+         sat_merged = 0;
+         fraig_sim_pairs.clear();
 
-      now_fec_grp = fec_groups->size();
-      if(now_fec_grp != last_fec_grp) {
-         last_fec_grp = now_fec_grp;
-         same_fec_counter = 0;
-      } else if(++same_fec_counter > surrender) {
-         // consider irreducible
-         break;
+         int dfn = 0;
+         int eqlit[nMaxVar+1];
+
+         memset(visited, 0, sizeof(char)*(nMaxVar+1));
+
+         for(int i = 0; i <= nMaxVar; ++i)
+            eqlit[i] = i<<1;
+
+         for(int i = 0; i < nOutputs; ++i) {
+            outputs[i]->setIN0(
+                  fraigDFS(dfn, visited, eqlit, outputs[i]->getIN0()));
+            if(sat_merged >= fraig_dfs_leave) break;
+         }
+
+         calculateRefCount();
+         mergeTrivial();
+         buildRevRef();
+         removeUnrefGates();
+
+         // between rounds the netlist and the groups agree
+         fraigCheckpoint(false);
+
+         now_fec_grp = fec_groups->size();
+         if(now_fec_grp != last_fec_grp) {
+            last_fec_grp = now_fec_grp;
+            same_fec_counter = 0;
+         } else if(++same_fec_counter > surrender) {
+            // consider irreducible
+            break;
+         }
+      } while(sat_merged >= fraig_dfs_leave && !fraig_stopped);
+   }
+
+   if(fraig_stopped)
+      printf("fraig: stopped early, %d FEC groups left unproven\n",
+            (int)fec_groups->size());
+
+   if(sat_undecided)
+      printf("fraig: %d pairs left unmerged, out of SAT effort\n",
+            sat_undecided);
+   if(fraig_cut_proved || fraig_cut_refuted)
+      printf("fraig: %d pairs proved, %d refuted by cut matching\n",
+            fraig_cut_proved, fraig_cut_refuted);
+   if(fraig_blacklist.size())
+      printf("fraig: %d pairs blacklisted (%d KB)\n",
+            (int)fraig_blacklist.size(),
+            (int)(fraig_blacklist.memUsage() >> 10));
+
+   if(fraig_ckpt) {
+      fraigCheckpoint(true);
+      delete fraig_ckpt;
+      fraig_ckpt = NULL;
+   }
+
+   // what is left of the groups stays, restricted to the cone
+   if(fec_scope) {
+      delete[] fec_scope;
+      fec_scope = NULL;
+   }
+
+   delete[] fraig_cone_val;
+   delete[] fraig_cone_mark;
+   delete[] fraig_pi_pos;
+   delete[] fraig_level;
+   delete[] fraig_sched_cost;
+   fraig_cuts.reset();
+   delete fraig_strash;
+   fraig_strash = NULL;
+   fraig_cone_val = NULL;
+   fraig_cone_mark = NULL;
+   fraig_pi_pos = NULL;
+   fraig_level = NULL;
+   fraig_sched_cost = NULL;
+}
+
+bool CirMgr::setFraigScope(const vector<int> &gids) {
+   for(int i = 0, n = gids.size(); i < n; ++i)
+      if(gids[i] < 0 || !getVar(gids[i])) {
+         fprintf(stderr, "Error: Gate(%d) not found!!\n", gids[i]);
+         return false;
+      }
+   fraig_scope = gids;
+   return true;
+}
+
+// mark the fanin cones of the scope and drop everything outside them
+// from the FEC groups. fraig only merges a gate into a member of its own
+// group, so the cones never grow while it runs and the marks stay valid.
+void CirMgr::fraigScopeInit() {
+   if(fec_scope) delete[] fec_scope;
+   fec_scope = new char[nMaxVar+1];
+   memset(fec_scope, 0, sizeof(char)*(nMaxVar+1));
+   fec_scope[0] = 1;
+
+   for(int i = 0, n = fraig_scope.size(); i < n; ++i) {
+      int gid = fraig_scope[i];
+      fraigScopeDFS(gid > nMaxVar ?
+            outputs[gid-nMaxVar-1]->getIN0()>>1 : gid);
+   }
+
+   int ngates = 0;
+   for(int i = 0; i < nGates; ++i)
+      if(fec_scope[gates[i]->getVarId()]) ngates++;
+   printf("fraig: scoped to %d of %d gates\n", ngates, nGates);
+
+   if(!fec_groups) return;
+
+   FECGrp *fec_new = new FECGrp();
+   for(int i = 0, n = fec_groups->size(); i < n; ++i) {
+      vector<int> *s = fec_groups->at(i);
+      vector<int> *cont = new vector<int>();
+      for(int j = 0, sz = s->size(); j < sz; ++j) {
+         if(fec_scope[s->at(j)>>1]) cont->push_back(s->at(j));
+         else vars[s->at(j)>>1]->setFecGroupId(-1);
+      }
+      delete s;
+
+      if(cont->size() < 2) {
+         for(int j = 0, sz = cont->size(); j < sz; ++j)
+            vars[cont->at(j)>>1]->setFecGroupId(-1);
+         delete cont;
+         continue;
       }
-   } while(sat_merged >= fraig_dfs_leave);
+      // phases relative to the first member
+      int gid = fec_new->size();
+      if(cont->at(0)&1)
+         for(int j = 0, sz = cont->size(); j < sz; ++j)
+            cont->at(j) ^= 1;
+      for(int j = 0, sz = cont->size(); j < sz; ++j)
+         vars[cont->at(j)>>1]->setFecGroup(gid, cont->at(j));
+      fec_new->push_back(cont);
+   }
+   delete fec_groups;
+   fec_groups = fec_new;
+   clearSimCone();
+}
+
+void CirMgr::fraigScopeDFS(int varid) {
+   if(fec_scope[varid]) return;
+   fec_scope[varid] = 1;
+
+   const CirVar *v = vars[varid];
+   if(v->getType() != AIG_GATE) return;
+   fraigScopeDFS(v->getIN0()>>1);
+   fraigScopeDFS(v->getIN1()>>1);
+}
+
+// reads only the limits, so workers may call it too
+bool CirMgr::fraigOverLimits(bool check_mem) const {
+   if(fraig_deadline > 0.0 && wallClockMs() >= fraig_deadline)
+      return true;
+   return check_mem && fraig_mem_limit > 0 &&
+      residentMB() >= fraig_mem_limit;
 }
 
-int CirMgr::fraigDFS(int &dfn, bool *visited, int *eqlit, int litid) {
+// latches once a limit is reached; memory is looked at every so often
+bool CirMgr::fraigOutOfBudget() {
+   if(fraig_stopped) return true;
+   if(!fraig_time_limit && !fraig_mem_limit) return false;
+
+   bool check_mem = (++fraig_limit_tick % FRAIG_MEM_CHECK_EVERY == 0);
+   if(!fraigOverLimits(check_mem)) return false;
+
+   fraig_stopped = true;
+   printf("fraig: %s limit reached, applying merges proven so far\n",
+         (fraig_deadline > 0.0 && wallClockMs() >= fraig_deadline) ?
+         "time" : "memory");
+   return true;
+}
+
+int CirMgr::fraigDFS(int &dfn, char *visited, int *eqlit, int litid) {
    int varid = litid>>1;
 
    if(sat_merged >= fraig_dfs_leave) return litid;
 
    if(visited[varid])
       return (eqlit[varid]&~1)|((eqlit[varid]^litid)&1);
-   visited[varid] = true;
+   visited[varid] = 1;
    dfn++;
 
    CirVar *v = getVar(varid);
@@ -253,10 +491,49 @@ int CirMgr::fraigDFS(int &dfn, bool *visited, int *eqlit, int litid) {
    if(v->getType() == AIG_GATE) {
       v->setIN0(fraigDFS(dfn, visited, eqlit, v->getIN0()));
       v->setIN1(fraigDFS(dfn, visited, eqlit, v->getIN1()));
-   } else
+   } else {
+      visited[varid] = 2;
       return litid;
+   }
 
-   SatAddGate(v);
+   // CNF is loaded per query, see SatLoadCone
+   visited[varid] = 2;
+   fraigMergeGate(dfn, visited, eqlit, varid);
+
+   return (eqlit[varid]&~1)|((eqlit[varid]^litid)&1);
+}
+
+// merge a gate whose fanins are final into an equivalent done gate or a
+// constant, if any: the result goes to eqlit[varid]
+void CirMgr::fraigMergeGate(int &dfn, const char *visited, int *eqlit,
+      int varid) {
+   CirVar *v = getVar(varid);
+
+   fraig_level[varid] = 1 + std::max(fraig_level[v->getIN0()>>1],
+                                     fraig_level[v->getIN1()>>1]);
+   // fanins may have been rewired since the cuts were taken
+   fraig_cuts.invalidate(varid);
+
+   // rewired fanins may have made it a duplicate
+   int dup = fraigStrashLookup(eqlit, varid, visited);
+   if(dup != varid) {
+      printf("fraig: <%d> strash %d to %d\n", dfn, varid, dup);
+      eqlit[varid] = dup<<1;
+      SatAddMerge(varid, eqlit[varid]);
+      return;
+   }
+
+   // exhaustively simulated constants
+   if(fec_exact && (sim_exact_seen[varid] == 1 ||
+            sim_exact_seen[varid] == 2)) {
+      int c = (sim_exact_seen[varid] == 2);
+      sat_merged++;
+
+      printf("fraig: <%d> merge %d to %d\n", dfn, varid, c);
+      eqlit[varid] = c;
+      SatAddMerge(varid, c);
+      return;
+   }
 
    // it is inefficient to hang on and solve all pairs.
    // when enough key-counter-patterns are collected,
@@ -267,81 +544,359 @@ int CirMgr::fraigDFS(int &dfn, bool *visited, int *eqlit, int litid) {
    bool retry = true;
    while(retry) {
       retry = false;
+      int pending_hits = 0;
+
+      // out of time or memory: the gate stays as it is
+      if(fraigOutOfBudget()) return;
 
       int grpid = v->getFecGroupId();
       const vector<int> *s = getFecGroup(grpid);
-      if(!s) return litid;
+      if(!s) return;
 
-      if(grpid == vars[0]->getFecGroupId()) {
+      if(!fec_exact && grpid == vars[0]->getFecGroupId() &&
+            !fraigSkipPair(0, varid)) {
          // check constant 0
-         printf("SAT: %d == 0 ?\r", varid);
-         fflush(stdout);
-         sat_solver.assumeRelease();
-         sat_solver.assumeProperty(sat_var[0], false);
-         sat_solver.assumeProperty(sat_var[varid], true);
-         if(!sat_solver.assumpSolve()) {
+         int cone = fraigCutMatch(varid, 0, false, false);
+         if(cone < 0) cone = fraigConeExhaustive(varid, 0, false, false);
+         if(cone < 0) {
+            int neq = SatSolveVarEQ(varid, 0, false);
+            if(neq < 0 && fraigOutOfBudget()) return;
+            if(neq < 0) SatRecordUndecided(varid, 0);
+            cone = (neq == 0);
+         }
+         if(cone) {
             sat_merged++;
 
             printf("fraig: <%d> merge %d to 0\n", dfn, varid);
             eqlit[varid] = 0;
-            return litid&1;
+            SatAddMerge(varid, 0);
+            return;
          }
 
          // check constant 1
-         printf("SAT: %d == 1 ?\r", varid);
-         fflush(stdout);
-         sat_solver.assumeRelease();
-         sat_solver.assumeProperty(sat_var[0], false);
-         sat_solver.assumeProperty(sat_var[varid], false);
-         if(!sat_solver.assumpSolve()) {
+         cone = fraigCutMatch(varid, 0, true, false);
+         if(cone < 0) cone = fraigConeExhaustive(varid, 0, true, false);
+         if(cone < 0) {
+            int neq = SatSolveVarEQ(varid, 0, true);
+            if(neq < 0 && fraigOutOfBudget()) return;
+            if(neq < 0) SatRecordUndecided(varid, 0);
+            cone = (neq == 0);
+         }
+         if(cone) {
             sat_merged++;
 
             printf("fraig: <%d> merge %d to 1\n", dfn, varid);
             eqlit[varid] = 1;
-            return (litid^1)&1;
+            SatAddMerge(varid, 1);
+            return;
          }
       }
 
-      for(vector<int>::const_iterator it = s->begin(), ed = s->end();
+      // fec and done -> solve EQ, cheapest first. merging into a gate
+      // still on the DFS stack would make a loop
+      vector<int> cand;
+      fraigRankCandidates(s, varid, visited, eqlit, cand);
+
+      for(vector<int>::const_iterator it = cand.begin(), ed = cand.end();
             it != ed; ++it) {
          int svarid = (*it)>>1;
-         if(svarid == varid) continue;
-
-         // fec and visited -> solve EQ
-         if(visited[svarid] && !vars[svarid]->isInBlacklist(varid)) {
-            int inv_flag = ((*it) ^ v->getFecLiteral()) & 1;
+         int inv_flag = ((*it) ^ v->getFecLiteral()) & 1;
+
+         // already separated by a word not yet refined
+         if(!simSignatureMatch(varid, svarid, inv_flag)) continue;
+
+         // same class after exhaustive simulation means equal; a shared
+         // cut may decide the pair, small cones are decided by
+         // enumerating their inputs
+         int cone = fec_exact ? 1 :
+            fraigCutMatch(varid, svarid, inv_flag, true);
+         if(cone < 0)
+            cone = fraigConeExhaustive(varid, svarid, inv_flag, true);
+
+         // a pending counterexample already separates the pair: no
+         // SAT call. once it happens often the group is stale, refine
+         // it early instead of waiting for a full buffer
+         if(cone < 0 && SatPendingSeparates(varid, svarid, inv_flag)) {
+            if(++pending_hits < FRAIG_EARLY_RESIM) continue;
+            SatSimulateKeyPatterns();
+            SatBlacklistNonseparatedVars();
+            retry = true;
+            break;
+         }
+         if(cone < 0 && fraigOutOfBudget()) return;
+         int neq = (cone < 0) ? SatSolveVarEQ(varid, svarid, inv_flag)
+                              : (cone == 0);
+
+         // out of budget: leave the pair alone for this run. cut short
+         // by the time limit it says nothing about the pair
+         if(neq < 0) {
+            if(fraigOutOfBudget()) return;
+            SatRecordUndecided(varid, svarid);
+            continue;
+         }
 
-            if(SatSolveVarEQ(varid, svarid, inv_flag)) {
-               // not-EQ, enqueue simulation pattern to separate sets
-               SatStoreKeyPattern();
+         if(neq) {
+            fraig_sched_cost[svarid] += FRAIG_SCHED_NEQ_COST;
 
+            if(fraig_cex_flip && cone < 0) {
+               // the model normally separates this pair, its neighbors
+               // usually split other groups as well
                fraig_sim_pairs.push_back(make_pair(varid, svarid));
+               SatSimulateCexNeighbors();
+               SatBlacklistNonseparatedVars();
+               retry = true;
+               break;
+            }
 
-               // retry now!
-               if(SatIsKeyPatternStorageFull()) {
-                  retry = true;
-                  SatSimulateKeyPatterns();
+            // not-EQ, enqueue simulation pattern to separate sets
+            // (the cone check has stored its own)
+            if(cone < 0) SatStoreKeyPattern();
 
-                  // add pair to blacklist if not separated
-                  SatBlacklistNonseparatedVars();
+            fraig_sim_pairs.push_back(make_pair(varid, svarid));
 
-                  break;
-               }
-            } else {
-               // EQ, merge
-               sat_merged++;
+            // retry now!
+            if(SatIsKeyPatternStorageFull()) {
+               retry = true;
+               SatSimulateKeyPatterns();
 
-               printf("fraig: <%d> merge %d to %d\n", dfn, varid, svarid);
-               eqlit[varid] = (svarid<<1)|inv_flag;
-               return (svarid<<1)|((litid^inv_flag)&1);
+               // add pair to blacklist if not separated
+               SatBlacklistNonseparatedVars();
+
+               break;
             }
+         } else {
+            // EQ, merge
+            sat_merged++;
+
+            printf("fraig: <%d> merge %d to %d\n", dfn, varid, svarid);
+            eqlit[varid] = (svarid<<1)|inv_flag;
+            SatAddMerge(varid, eqlit[varid]);
+            return;
          }
       }
    }
+}
+
+// one pass over the gates in topological order: fanins are rewired
+// through eqlit when a gate is reached and merges apply in place, so
+// nothing is traversed twice and there is no restart from the outputs
+void CirMgr::fraigSweep() {
+   int *ord = new int[nMaxVar+1];
+   int *order = new int[nMaxVar+1];
+   int *eqlit = new int[nMaxVar+1];
+   char *visited = new char[nMaxVar+1];
+
+   for(int i = 0; i <= nMaxVar; ++i) {
+      ord[i] = -1;
+      eqlit[i] = i<<1;
+   }
+   memset(visited, 0, sizeof(char)*(nMaxVar+1));
+
+   int n = 0;
+   ord[0] = n++;
+   for(int i = 0; i < nOutputs; ++i)
+      fraigParOrderDFS(ord, n, outputs[i]->getIN0()>>1);
+   for(int i = 0; i <= nMaxVar; ++i)
+      if(ord[i] >= 0) order[ord[i]] = i;
+
+   sat_merged = 0;
+   fraig_sim_pairs.clear();
+
+   int dfn = 0;
+   for(int k = 0; k < n; ++k) {
+      int varid = order[k];
+      CirVar *v = vars[varid];
+
+      dfn++;
+      visited[varid] = 2;
+      if(v->getType() != AIG_GATE) continue;
+
+      v->setIN0(fraigResolveLit(eqlit, v->getIN0()));
+      v->setIN1(fraigResolveLit(eqlit, v->getIN1()));
+      fraigMergeGate(dfn, visited, eqlit, varid);
+      fraigCheckpoint(false, eqlit);
+   }
+
+   for(int i = 0; i < nOutputs; ++i)
+      outputs[i]->setIN0(
+            fraigResolveLit(eqlit, outputs[i]->getIN0()));
+
+   printf("fraig: swept %d vars, %d merged\n", n, sat_merged);
+
+   delete[] ord;
+   delete[] order;
+   delete[] eqlit;
+   delete[] visited;
+}
 
+// follow merges until a var that is not merged away; a gate may have
+// been merged into one that is merged itself
+int CirMgr::fraigResolveLit(const int *eqlit, int litid) {
+   while((eqlit[litid>>1]>>1) != (litid>>1))
+      litid = eqlit[litid>>1]^(litid&1);
    return litid;
 }
 
+// structural hash of the live AIG gates, kept across fraig rounds.
+// entries go stale when a gate is removed or rewired; they are checked
+// against the gate on lookup instead of being deleted.
+void CirMgr::fraigStrashInit() {
+   fraig_strash = new Hash<VarHashKey, int>(nGates + 1);
+
+   for(int i = 0; i < nGates; ++i)
+      if(!gates[i]->isRemoved())
+         fraig_strash->insert(VarHashKey(gates[i]), gates[i]->getVarId());
+}
+
+// a live gate with the same fanins as varid, or varid itself (which
+// then takes over a stale entry). gates merged away in eqlit are not
+// live any more. with visited, only a gate already done counts: one
+// still to come may reach varid through a merge made before it is
+// rewired. it finds varid instead when its turn comes.
+int CirMgr::fraigStrashLookup(const int *eqlit, int varid,
+      const char *visited) {
+   CirVar *v = vars[varid];
+   VarHashKey k(v);
+   int g;
+
+   if(fraig_strash->check(k, g) && g != varid) {
+      CirVar *u = vars[g];
+      if(!u->isRemoved() && u->getType() == AIG_GATE &&
+            eqlit[g] == (g<<1) && VarHashKey(u) == k &&
+            (!visited || visited[g] == 2))
+         return g;
+   }
+   fraig_strash->replaceInsert(k, varid);
+   return varid;
+}
+
+// decide v0 == (v1 ^ inv_flag) by simulating all assignments of the
+// inputs of their joint fanin cone, if it has at most FRAIG_CONE_MAX_PI.
+// return 1 if equal, 0 if not (keep_cex stores the distinguishing
+// pattern as a key pattern), -1 if the support is too large.
+int CirMgr::fraigConeExhaustive(int v0, int v1, bool inv_flag,
+      bool keep_cex) {
+   fraig_cone.clear();
+   fraig_cone_pis.clear();
+   fraig_cone_stamp++;
+
+   if(!fraigConeDFS(v0) || !fraigConeDFS(v1))
+      return -1;
+
+   const int per_word = sizeof(gateval_t)*8;
+   int k = fraig_cone_pis.size();
+   long long nwords = ((1LL << k) + per_word - 1) / per_word;
+   gateval_t *val = fraig_cone_val;
+   gateval_t mask = inv_flag ? ~(gateval_t)0 : 0;
+
+   for(long long w = 0; w < nwords; ++w) {
+      for(int j = 0; j < k; ++j)
+         val[fraig_cone_pis[j]] = enumerationWord(j, w);
+
+      for(int i = 0, n = fraig_cone.size(); i < n; ++i) {
+         const CirVar *g = vars[fraig_cone[i]];
+         int in0 = g->getIN0(), in1 = g->getIN1();
+         val[fraig_cone[i]] = (val[in0>>1] ^ -(gateval_t)(in0&1)) &
+                              (val[in1>>1] ^ -(gateval_t)(in1&1));
+      }
+
+      gateval_t diff = val[v0] ^ val[v1] ^ mask;
+      if(!diff) continue;
+
+      if(keep_cex) {
+         int b = 0;
+         while(!((diff >> b) & 1)) ++b;
+
+         // PIs outside the cone do not matter, leave them 0
+         gateval_t *kp = SatNewKeyPattern();
+         int kb = (sat_keypat_size-1) % W;
+         for(int i = 0; i < nInputs; ++i) {
+            int id = inputs[i]->getVarId();
+            if(fraig_cone_mark[id] == fraig_cone_stamp)
+               kp[i] |= ((val[id] >> b) & 1) << kb;
+         }
+      }
+      return 0;
+   }
+   return 1;
+}
+
+// 1 if v0 == (v1 ^ inv_flag) over a cut of v0 and one of v1 whose leaves
+// it contains (or the other way round), 0 if the two differ over such a
+// cut of PIs only: leaves of gates may not take every combination. the
+// differing minterm becomes a key pattern if keep_cex. -1 if no pair of
+// cuts decides.
+int CirMgr::fraigCutMatch(int v0, int v1, bool inv_flag, bool keep_cex) {
+   int n0, n1;
+   const CirCut *c0 = fraig_cuts.getCuts(v0, n0);
+   const CirCut *c1 = fraig_cuts.getCuts(v1, n1);
+   uint64_t mask = inv_flag ? ~(uint64_t)0 : 0;
+
+   for(int i = 0; i < n0; ++i) {
+      for(int j = 0; j < n1; ++j) {
+         const CirCut *big;
+         uint64_t diff;
+         if(c1[j].subsetOf(c0[i])) {
+            big = &c0[i];
+            diff = c0[i].truth ^
+               CirCutMgr::stretch(c1[j].truth, c1[j], c0[i]);
+         } else if(c0[i].subsetOf(c1[j])) {
+            big = &c1[j];
+            diff = c1[j].truth ^
+               CirCutMgr::stretch(c0[i].truth, c0[i], c1[j]);
+         } else
+            continue;
+         diff ^= mask;
+
+         if(!diff) {
+            fraig_cut_proved++;
+            return 1;
+         }
+
+         bool all_pis = true;
+         for(int l = 0; l < big->nleaves && all_pis; ++l)
+            all_pis = vars[big->leaves[l]]->getType() == PI_GATE;
+         if(!all_pis) continue;
+
+         if(keep_cex) {
+            int b = 0;
+            while(!((diff >> b) & 1)) ++b;
+
+            // PIs outside the cut do not matter, leave them 0
+            gateval_t *kp = SatNewKeyPattern();
+            int kb = (sat_keypat_size-1) % W;
+            for(int l = 0; l < big->nleaves; ++l)
+               kp[fraig_pi_pos[big->leaves[l]]] |=
+                  (gateval_t)((b >> l) & 1) << kb;
+         }
+         fraig_cut_refuted++;
+         return 0;
+      }
+   }
+   return -1;
+}
+
+bool CirMgr::fraigConeDFS(int varid) {
+   if(fraig_cone_mark[varid] == fraig_cone_stamp) return true;
+   fraig_cone_mark[varid] = fraig_cone_stamp;
+
+   CirVar *v = vars[varid];
+   switch(v->getType()) {
+      case PI_GATE:
+         fraig_cone_pis.push_back(varid);
+         return (int)fraig_cone_pis.size() <= FRAIG_CONE_MAX_PI;
+      case AIG_GATE:
+         if(!fraigConeDFS(v->getIN0()>>1) || !fraigConeDFS(v->getIN1()>>1))
+            return false;
+         fraig_cone.push_back(varid);
+         return true;
+      default:
+         // constant and undefined gates simulate to 0
+         fraig_cone_val[varid] = 0;
+         return true;
+   }
+}
+
 void CirMgr::fraigReducePairs() {
    printf("try to reduce group size to average\n");
 
@@ -355,7 +910,7 @@ void CirMgr::fraigReducePairs() {
       SatSetupInputs();
 
       for(int i = 0; i < nOutputs; ++i)
-         SatAddGateDFS(visited, vars[outputs[i]->getIN0()>>1]);
+         SatLoadCone(outputs[i]->getIN0()>>1);
 
       for(int i = 0; i <= nMaxVar; ++i)
          reducible[i] = i<<1;
@@ -418,7 +973,10 @@ bool CirMgr::fraigReducePairsLoop(int *reducible) {
             int inv_flag = (litid0 ^ litid) & 1;
 
             printf("[g:%d, %d/%d] ", i, j, sz);
-            if(SatSolveVarEQ(varid0, varid, inv_flag)) {
+            int neq = SatSolveVarEQ(varid0, varid, inv_flag);
+            if(neq < 0) {
+               SatRecordUndecided(varid0, varid);
+            } else if(neq) {
                // not-EQ, enqueue simulation pattern to separate sets
                SatStoreKeyPattern();
 
@@ -447,21 +1005,36 @@ bool CirMgr::fraigReducePairsLoop(int *reducible) {
    return false;
 }
 
-bool CirMgr::SatSolveVarEQ(int v0, int v1, bool inv_flag) {
-   // EQ
-   Var feq = sat_solver.newVar();
+// 1 if v0 != (v1 ^ inv_flag) (the model separates them), 0 if equal,
+// -1 if the effort budget ran out
+int CirMgr::SatSolveVarEQ(int v0, int v1, bool inv_flag) {
+   SatLoadCone(v0);
+   SatLoadCone(v1);
 
-   sat_solver.addXorCNF(feq, 
+   // miter guarded by an activation var, released after the query: its
+   // clauses (and learnts depending on it) get removed by simplifyDB,
+   // which then hands the var out again
+   Var act = sat_solver.newVar();
+   sat_solver.setDecisionVar(act, false);
+
+   sat_solver.addMiterCNF(act,
          sat_var[v0], false, sat_var[v1], inv_flag);
 
    sat_solver.assumeRelease();
    sat_solver.assumeProperty(sat_var[0], false);
-   sat_solver.assumeProperty(feq, true);
+   sat_solver.assumeProperty(act, true);
 
    printf("SAT: %d == %s%d ?\r", v0, inv_flag?"!":"", v1);
    fflush(stdout);
 
-   return sat_solver.assumpSolve();
+   double start = wallClockMs();
+   int ret = sat_solver.assumpSolveLimited();
+   sat_time += wallClockMs() - start;
+   sat_calls++;
+
+   sat_solver.releaseVar(act, false);
+
+   return ret;
 }
 
 void CirMgr::SatSetupInputs() {
@@ -470,9 +1043,17 @@ void CirMgr::SatSetupInputs() {
    if(sat_var) delete sat_var;
    sat_var = new Var[nMaxVar+1];
 
+   // nothing is branched on until SatLoadCone brings in its inputs
    for(int i = 0; i <= nMaxVar; i++) {
       sat_var[i] = sat_solver.newVar();
+      sat_solver.setDecisionVar(sat_var[i], false);
    }
+   sat_solver.assertProperty(sat_var[0], false);
+   sat_solver.setBudget(sat_conflict_budget, sat_prop_budget);
+
+   if(!sat_added) sat_added = new bool[nMaxVar+1];
+   memset(sat_added, 0, sizeof(bool)*(nMaxVar+1));
+   sat_added[0] = true;
 }
 
 void CirMgr::SatAddGate(CirVar *v) {
@@ -480,51 +1061,206 @@ void CirMgr::SatAddGate(CirVar *v) {
    sat_solver.addAigCNF(sat_var[v->getVarId()],
          sat_var[v->getIN0()>>1], v->getIN0()&1,
          sat_var[v->getIN1()>>1], v->getIN1()&1);
+   sat_added[v->getVarId()] = true;
 }
 
-void CirMgr::SatAddGateDFS(bool *visited, CirVar *v) {
-   int varid = v->getVarId();
+// a pair the effort budget could not decide stays unmerged for the rest
+// of this fraig; a later one, maybe at a higher effort, tries it again
+void CirMgr::SatRecordUndecided(int v0, int v1) {
+   sat_undecided++;
+   fraig_undecided.insert(v0, v1);
+   fraig_sched_cost[v1] += FRAIG_SCHED_HARD_COST;
 
-   if(visited[varid]) return;
-   visited[varid] = true;
+   printf("fraig: %d <-> %d undecided\n", v0, v1);
+}
+
+// members of varid's group it may be merged into, cheapest query first.
+// a representative costs its logic level, so shallow ones come first:
+// their merges are easy and simplify the deeper cones tried later, plus
+// what queries against it have cost so far. ties keep group order.
+void CirMgr::fraigRankCandidates(const vector<int> *s, int varid,
+      const char *visited, const int *eqlit, vector<int> &cand) {
+   vector<pair<pair<int, int>, int> > ranked;
+
+   for(int i = 0, sz = s->size(); i < sz; ++i) {
+      int svarid = s->at(i)>>1;
+      if(svarid == varid || visited[svarid] != 2 ||
+            fraigSkipPair(svarid, varid))
+         continue;
+
+      int cost = fraig_level[svarid] + fraig_sched_cost[svarid];
+      ranked.push_back(make_pair(make_pair(cost, i), s->at(i)));
+   }
+   sort(ranked.begin(), ranked.end());
 
+   cand.clear();
+   for(int i = 0, sz = ranked.size(); i < sz; ++i)
+      cand.push_back(ranked[i].second);
+}
+
+// a proven merge of var into literal lit
+void CirMgr::SatAddMerge(int varid, int lit) {
+   sat_solver.addEqCNF(sat_var[varid], false, sat_var[lit>>1], lit&1);
+}
+
+// add CNF for the not yet loaded fanin cone of varid. gate values follow
+// from the inputs by propagation, only the inputs become decision vars.
+void CirMgr::SatLoadCone(int varid) {
+   if(sat_added[varid]) return;
+
+   CirVar *v = vars[varid];
    if(v->getType() == AIG_GATE) {
-      SatAddGateDFS(visited, vars[v->getIN0()>>1]);
-      SatAddGateDFS(visited, vars[v->getIN1()>>1]);
+      SatLoadCone(v->getIN0()>>1);
+      SatLoadCone(v->getIN1()>>1);
       SatAddGate(v);
+   } else {
+      sat_solver.setDecisionVar(sat_var[varid], true);
+      sat_added[varid] = true;
    }
 }
 
-void CirMgr::SatStoreKeyPattern() {
+// model value of an input; inputs outside the queried cones are
+// unassigned and get a random bit
+int CirMgr::SatModelBit(int varid) {
+   int val = sat_solver.getValue(sat_var[varid]);
+   return val < 0 ? (int)(sim_rng.next64() & 1) : val;
+}
+
+// key pattern k is bit k%W of word k/W; the words of one slot are laid
+// out PI by PI, ready for simulateWord. return the word of the next
+// pattern, its bit is zero for every PI.
+gateval_t *CirMgr::SatNewKeyPattern() {
    if(!sat_keypat) {
-      sat_keypat = new gateval_t[nInputs];
+      sat_keypat = new gateval_t[nInputs*sat_keypat_words];
+      memset(sat_keypat, 0, sizeof(gateval_t)*nInputs*sat_keypat_words);
       sat_keypat_size = 0;
    }
 
-   sat_keypat_size++;
-   for(int i = 0; i < nInputs; ++i) {
-      int varid = inputs[i]->getVarId();
-      sat_keypat[i] <<= 1;
-      sat_keypat[i] |= (1 & sat_solver.getValue(sat_var[varid]));
-   }
+   return &sat_keypat[(sat_keypat_size++ / W) * nInputs];
+}
+
+void CirMgr::SatStoreKeyPattern() {
+   gateval_t *kp = SatNewKeyPattern();
+   int b = (sat_keypat_size-1) % W;
+   for(int i = 0; i < nInputs; ++i)
+      kp[i] |= (gateval_t)SatModelBit(inputs[i]->getVarId()) << b;
 }
 
-bool CirMgr::SatIsKeyPatternStorageFull() const {
-   return sat_keypat_size == (sizeof(gateval_t)*8);
+// same, from one '0'/'1' per PI
+void CirMgr::SatStoreKeyPattern(const char *bits) {
+   gateval_t *kp = SatNewKeyPattern();
+   int b = (sat_keypat_size-1) % W;
+   for(int i = 0; i < nInputs; ++i)
+      kp[i] |= (gateval_t)(bits[i] == '1') << b;
+}
+
+void CirMgr::setFraigKeyPatterns(int n) {
+   int words = (n + W - 1) / W;
+   if(words < 1) words = 1;
+   if(words == sat_keypat_words) return;
+
+   // pending patterns are not worth keeping across a resize
+   if(sat_keypat) delete[] sat_keypat;
+   sat_keypat = NULL;
+   sat_keypat_size = 0;
+   sat_keypat_words = words;
 }
 
 int CirMgr::SatSimulateKeyPatterns() {
-   printf("fraig: simulating key patterns\n");
+   printf("fraig: simulating %d key patterns\n", sat_keypat_size);
 
-   int ret = simulate(sat_keypat, NULL);
+   // fraig keeps rewiring the circuit, never reuse a cone
+   for(int w = 0, nw = (sat_keypat_size + W - 1) / W; w < nw; ++w)
+      simulate(&sat_keypat[w*nInputs], NULL);
+   clearSimCone();
+   int ret = refineFecGroups();
 
    printf("fraig: current #FEC groups: %d\n", (int)fec_groups->size());
 
+   if(sat_keypat)
+      memset(sat_keypat, 0, sizeof(gateval_t)*nInputs*sat_keypat_words);
    sat_keypat_size = 0;
 
    return ret;
 }
 
+// true if a key pattern not yet simulated separates v0 and
+// (v1 ^ inv_flag). only their joint fanin cone is evaluated.
+bool CirMgr::SatPendingSeparates(int v0, int v1, bool inv_flag) {
+   if(sat_keypat_size == 0) return false;
+
+   fraig_cone.clear();
+   fraig_cone_pis.clear();
+   fraig_cone_stamp++;
+   fraigPendingConeDFS(v0);
+   fraigPendingConeDFS(v1);
+
+   gateval_t *val = fraig_cone_val;
+   gateval_t mask = inv_flag ? ~(gateval_t)0 : 0;
+
+   for(int w = 0, nw = (sat_keypat_size + W - 1) / W; w < nw; ++w) {
+      const gateval_t *kp = &sat_keypat[w*nInputs];
+      for(int j = 0, k = fraig_cone_pis.size(); j < k; ++j)
+         val[fraig_cone_pis[j]] = kp[fraig_pi_pos[fraig_cone_pis[j]]];
+
+      for(int i = 0, n = fraig_cone.size(); i < n; ++i) {
+         const CirVar *g = vars[fraig_cone[i]];
+         int in0 = g->getIN0(), in1 = g->getIN1();
+         val[fraig_cone[i]] = (val[in0>>1] ^ -(gateval_t)(in0&1)) &
+                              (val[in1>>1] ^ -(gateval_t)(in1&1));
+      }
+
+      if(val[v0] ^ val[v1] ^ mask) return true;
+   }
+   return false;
+}
+
+void CirMgr::fraigPendingConeDFS(int varid) {
+   if(fraig_cone_mark[varid] == fraig_cone_stamp) return;
+   fraig_cone_mark[varid] = fraig_cone_stamp;
+
+   CirVar *v = vars[varid];
+   switch(v->getType()) {
+      case PI_GATE:
+         fraig_cone_pis.push_back(varid);
+         break;
+      case AIG_GATE:
+         fraigPendingConeDFS(v->getIN0()>>1);
+         fraigPendingConeDFS(v->getIN1()>>1);
+         fraig_cone.push_back(varid);
+         break;
+      default:
+         fraig_cone_val[varid] = 0;
+   }
+}
+
+// expand the current SAT model into a word: slot 0 is the model, the
+// other slots each flip one PI. PIs are flipped round-robin over calls.
+int CirMgr::SatSimulateCexNeighbors() {
+   const int per_word = sizeof(gateval_t)*8;
+
+   gateval_t vin[nInputs];
+   char patt[nInputs+1];
+
+   for(int i = 0; i < nInputs; ++i) {
+      int bit = SatModelBit(inputs[i]->getVarId());
+      vin[i] = bit ? ~(gateval_t)0 : 0;
+      patt[i] = bit ? '1' : '0';
+   }
+   patt[nInputs] = '\0';
+   keepSimulationPattern(patt);
+
+   if(nInputs > 0) {
+      for(int k = 1; k < per_word; ++k)
+         vin[(fraig_flip_cursor + k - 1) % nInputs] ^= ((gateval_t)1 << k);
+      fraig_flip_cursor = (fraig_flip_cursor + per_word - 1) % nInputs;
+   }
+
+   simulateWord(vin, NULL);
+   clearSimCone();
+   return refineFecGroups();
+}
+
 void CirMgr::SatBlacklistNonseparatedVars() {
    for(vector<pair<int, int> >::iterator it =
          fraig_sim_pairs.begin(), ed = fraig_sim_pairs.end();
@@ -536,8 +1272,7 @@ void CirMgr::SatBlacklistNonseparatedVars() {
             vars[it->first ]->getFecGroupId() ==
             vars[it->second]->getFecGroupId()) {
 
-         vars[it->first ]->addBlacklist(it->second);
-         vars[it->second]->addBlacklist(it->first );
+         fraig_blacklist.insert(it->first, it->second);
 
          printf("fraig: %d <-> %d added to blacklist\n",
                it->first, it->second);
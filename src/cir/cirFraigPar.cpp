@@ -0,0 +1,328 @@
+/****************************************************************************
+  FileName     [ cirFraigPar.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define parallel fraig over worker threads ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cstring>
+#include <cassert>
+#include <pthread.h>
+#include "cirMgr.h"
+#include "cirGate.h"
+
+#include "sat.h"
+
+using namespace std;
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+// candidate pairs proven between two commits
+#define FRAIG_PAR_BATCH 4096
+
+// pairs a worker proves between two reads of the resident memory size
+#define FRAIG_PAR_MEM_CHECK_EVERY 64
+
+// v0 == (v1 ^ inv_flag) ? v1 comes first in topological order, so v0 is
+// the one merged away
+struct FraigParPair {
+   int v0, v1;
+   bool inv_flag;
+   int result;    // 1: differ, 0: equal, -1: out of budget,
+                  // -2: not tried, fraig limits reached
+   int patt;      // offset of the model in the worker's patts
+   int worker;
+};
+
+// one solver per thread, loaded with the cones of its own pairs only.
+// pairs are dealt round-robin, so every worker sees the same sequence of
+// queries whatever the scheduling: results are deterministic.
+struct FraigParWorker {
+   CirMgr *mgr;
+   pthread_t thread;
+   SatSolver solver;
+   Var *var;
+   bool *loaded;
+   CirRandomGen rng;
+   vector<FraigParPair *> pairs;
+   // one '0'/'1' per PI for each pair that differs
+   vector<char> patts;
+};
+
+/*******************************************/
+/*   class CirMgr member functions: fraig  */
+/*******************************************/
+void CirMgr::fraigParallel() {
+   int nthreads = fraig_threads;
+   FraigParWorker *workers = new FraigParWorker[nthreads];
+
+   for(int t = 0; t < nthreads; ++t) {
+      FraigParWorker &w = workers[t];
+      w.mgr = this;
+      w.var = new Var[nMaxVar+1];
+      w.loaded = new bool[nMaxVar+1];
+      memset(w.loaded, 0, sizeof(bool)*(nMaxVar+1));
+      w.rng.setSeed(t);
+
+      w.solver.initialize();
+      w.solver.setBudget(sat_conflict_budget, sat_prop_budget);
+      w.solver.setDeadline(fraig_deadline);
+      w.var[0] = w.solver.newVar();
+      w.solver.assertProperty(w.var[0], false);
+      w.loaded[0] = true;
+   }
+
+   int *ord = new int[nMaxVar+1];
+   int *eqlit = new int[nMaxVar+1];
+   bool visited[nMaxVar+1];
+   vector<FraigParPair> pairs;
+
+   for(;;) {
+      if(fraigOutOfBudget()) break;
+
+      // topological order of what the outputs reach, constant first
+      for(int i = 0; i <= nMaxVar; ++i) ord[i] = -1;
+      int n = 0;
+      ord[0] = n++;
+      for(int i = 0; i < nOutputs; ++i)
+         fraigParOrderDFS(ord, n, outputs[i]->getIN0()>>1);
+
+      pairs.clear();
+      fraigParCollectPairs(ord, pairs);
+      if(pairs.empty()) break;
+
+      printf("fraig: proving %d pairs on %d threads\n",
+            (int)pairs.size(), nthreads);
+
+      for(int t = 0; t < nthreads; ++t) {
+         workers[t].pairs.clear();
+         workers[t].patts.clear();
+      }
+      for(int i = 0, sz = pairs.size(); i < sz; ++i) {
+         pairs[i].worker = i % nthreads;
+         workers[i % nthreads].pairs.push_back(&pairs[i]);
+      }
+
+      double start = wallClockMs();
+
+      bool started[nthreads];
+      for(int t = 0; t < nthreads; ++t)
+         started[t] = (pthread_create(&workers[t].thread, NULL,
+                  fraigParThread, &workers[t]) == 0);
+      for(int t = 0; t < nthreads; ++t) {
+         if(started[t]) pthread_join(workers[t].thread, NULL);
+         // no thread, prove here
+         else fraigParWork(&workers[t]);
+      }
+
+      sat_time += wallClockMs() - start;
+
+      // commit in candidate order
+      int merged = 0, untried = 0;
+      for(int i = 0; i <= nMaxVar; ++i)
+         eqlit[i] = i<<1;
+
+      for(int i = 0, sz = pairs.size(); i < sz; ++i) {
+         const FraigParPair &p = pairs[i];
+         if(p.result == -2) {
+            untried++;
+            continue;
+         }
+         sat_calls++;
+
+         if(p.result == 0) {
+            printf("fraig: merge %d to %s%d\n", p.v0,
+                  p.inv_flag?"!":"", p.v1);
+            eqlit[p.v0] = (p.v1<<1)|p.inv_flag;
+            merged++;
+         } else if(p.result > 0) {
+            fraig_sim_pairs.push_back(make_pair(p.v0, p.v1));
+            SatStoreKeyPattern(&workers[p.worker].patts[p.patt]);
+            if(SatIsKeyPatternStorageFull())
+               SatSimulateKeyPatterns();
+         } else
+            SatRecordUndecided(p.v0, p.v1);
+      }
+
+      if(sat_keypat_size) SatSimulateKeyPatterns();
+      SatBlacklistNonseparatedVars();
+
+      if(merged) {
+         memset(visited, 0, sizeof(bool)*(nMaxVar+1));
+         for(int i = 0; i < nOutputs; ++i)
+            outputs[i]->setIN0(
+                  fraigParMergeDFS(visited, eqlit, outputs[i]->getIN0()));
+
+         calculateRefCount();
+         mergeTrivial();
+         buildRevRef();
+         removeUnrefGates();
+      }
+
+      // between batches the netlist and the groups agree
+      fraigCheckpoint(false);
+
+      if(untried) {
+         fraig_stopped = true;
+         printf("fraig: limits reached, %d pairs left untried\n", untried);
+         break;
+      }
+   }
+
+   for(int t = 0; t < nthreads; ++t) {
+      delete[] workers[t].var;
+      delete[] workers[t].loaded;
+   }
+   delete[] workers;
+   delete[] ord;
+   delete[] eqlit;
+}
+
+void *CirMgr::fraigParThread(void *arg) {
+   FraigParWorker *w = (FraigParWorker *)arg;
+   w->mgr->fraigParWork(w);
+   return NULL;
+}
+
+// runs on a worker thread: reads the netlist, writes only to w and the
+// results of its own pairs
+void CirMgr::fraigParWork(FraigParWorker *w) {
+   bool over = false;
+   for(int i = 0, sz = w->pairs.size(); i < sz; ++i) {
+      FraigParPair *p = w->pairs[i];
+
+      // the rest is left for the commit to skip
+      if(over || (over = fraigOverLimits(
+                  i % FRAIG_PAR_MEM_CHECK_EVERY == 0))) {
+         p->result = -2;
+         continue;
+      }
+
+      fraigParLoad(w, p->v0);
+      fraigParLoad(w, p->v1);
+
+      // same activation scheme as SatSolveVarEQ
+      Var act = w->solver.newVar();
+      w->solver.setDecisionVar(act, false);
+      w->solver.addMiterCNF(act,
+            w->var[p->v0], false, w->var[p->v1], p->inv_flag);
+
+      w->solver.assumeRelease();
+      w->solver.assumeProperty(act, true);
+      p->result = w->solver.assumpSolveLimited();
+      // stopped by the deadline: untried, not undecided
+      if(p->result < 0 && (over = fraigOverLimits(false)))
+         p->result = -2;
+
+      if(p->result > 0) {
+         p->patt = w->patts.size();
+         for(int j = 0; j < nInputs; ++j) {
+            int id = inputs[j]->getVarId();
+            int bit = w->loaded[id] ? w->solver.getValue(w->var[id]) : -1;
+            if(bit < 0) bit = w->rng.next64() & 1;
+            w->patts.push_back(bit ? '1' : '0');
+         }
+      }
+
+      w->solver.releaseVar(act, false);
+   }
+}
+
+// CNF of the not yet loaded fanin cone of varid into the worker's solver.
+// CNF loaded in an earlier batch stays valid: merges only rewire fanins
+// to proven equivalents.
+void CirMgr::fraigParLoad(FraigParWorker *w, int varid) {
+   if(w->loaded[varid]) return;
+   w->loaded[varid] = true;
+
+   const CirVar *v = vars[varid];
+   w->var[varid] = w->solver.newVar();
+
+   if(v->getType() == AIG_GATE) {
+      int in0 = v->getIN0(), in1 = v->getIN1();
+      fraigParLoad(w, in0>>1);
+      fraigParLoad(w, in1>>1);
+      w->solver.setDecisionVar(w->var[varid], false);
+      w->solver.addAigCNF(w->var[varid],
+            w->var[in0>>1], in0&1, w->var[in1>>1], in1&1);
+   }
+}
+
+void CirMgr::fraigParOrderDFS(int *ord, int &n, int varid) {
+   if(ord[varid] >= 0) return;
+
+   const CirVar *v = vars[varid];
+   if(v->getType() == AIG_GATE) {
+      fraigParOrderDFS(ord, n, v->getIN0()>>1);
+      fraigParOrderDFS(ord, n, v->getIN1()>>1);
+   }
+   ord[varid] = n++;
+}
+
+// every reachable gate of a group against the member that comes first in
+// topological order, so merges can never form a loop
+void CirMgr::fraigParCollectPairs(const int *ord,
+      vector<FraigParPair> &pairs) {
+   for(int g = 0, ng = fec_groups->size(); g < ng; ++g) {
+      const vector<int> *s = fec_groups->at(g);
+
+      int rep = -1;
+      for(int j = 0, sz = s->size(); j < sz; ++j) {
+         int id = s->at(j)>>1;
+         if(ord[id] < 0 || vars[id]->isRemoved()) continue;
+         if(rep < 0 || ord[id] < ord[s->at(rep)>>1]) rep = j;
+      }
+      if(rep < 0) continue;
+
+      int r = s->at(rep)>>1;
+      for(int j = 0, sz = s->size(); j < sz; ++j) {
+         int id = s->at(j)>>1;
+         if(j == rep || ord[id] < 0 || vars[id]->isRemoved() ||
+               vars[id]->getType() != AIG_GATE)
+            continue;
+
+         bool inv_flag = (s->at(j) ^ s->at(rep)) & 1;
+         if(fraigSkipPair(r, id)) continue;
+         if(!simSignatureMatch(id, r, inv_flag)) continue;
+
+         FraigParPair p;
+         p.v0 = id;
+         p.v1 = r;
+         p.inv_flag = inv_flag;
+         p.result = -1;
+         p.patt = -1;
+         pairs.push_back(p);
+         if((int)pairs.size() == FRAIG_PAR_BATCH) return;
+      }
+   }
+}
+
+// rewire fanins along eqlit; a merged var is replaced by its target,
+// whose own cone is rewired in turn. gates that end up with the fanins
+// of another gate are merged into it as well.
+int CirMgr::fraigParMergeDFS(bool *visited, int *eqlit, int litid) {
+   int varid = litid>>1;
+
+   if((eqlit[varid]>>1) != varid)
+      return fraigParMergeDFS(visited, eqlit, eqlit[varid]^(litid&1));
+
+   if(!visited[varid]) {
+      visited[varid] = true;
+
+      CirVar *v = vars[varid];
+      if(v->getType() == AIG_GATE) {
+         v->setIN0(fraigParMergeDFS(visited, eqlit, v->getIN0()));
+         v->setIN1(fraigParMergeDFS(visited, eqlit, v->getIN1()));
+
+         int dup = fraigStrashLookup(eqlit, varid);
+         if(dup != varid) {
+            printf("fraig: strash %d to %d\n", varid, dup);
+            eqlit[varid] = dup<<1;
+         }
+      }
+   }
+
+   return (eqlit[varid]&~1)|((eqlit[varid]^litid)&1);
+}
@@ -0,0 +1,420 @@
+/****************************************************************************
+  FileName     [ cirFraigPart.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define partitioned fraig over output clusters ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <pthread.h>
+#include "cirMgr.h"
+#include "cirGate.h"
+#include "myHash.h"
+
+using namespace std;
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+// a group of POs fraiged as one standalone circuit. the result is a
+// compact AIG: 0 is the constant, 1..pis.size() the inputs in pis order,
+// then two fanin literals per AND in topological order
+struct FraigPartition {
+   vector<int> pos;     // parent PO indices
+   vector<int> pis;     // parent PI indices, ascending
+   vector<int> ands;
+   vector<int> outs;    // one literal per PO of pos
+
+   void swap(FraigPartition &p) {
+      pos.swap(p.pos);
+      pis.swap(p.pis);
+      ands.swap(p.ands);
+      outs.swap(p.outs);
+   }
+};
+
+// the partitions fraiged so far merged into one AIG, numbered like a
+// FraigPartition over all PIs. partitions go in in their order whatever
+// thread finishes first, so the result does not depend on scheduling.
+struct FraigPartResult {
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   int next_take, next_stitch;
+   vector<int> ands;
+   vector<int> po_lit;
+   Hash<VarHashKey, int> *strash;
+};
+
+// workers take the next partition in order, then extract, fraig, export
+// and stitch it before taking another: only a partition per thread is in
+// memory besides the parent netlist and the result
+struct FraigPartWorker {
+   CirMgr *mgr;
+   pthread_t thread;
+   vector<FraigPartition> *parts;
+   FraigPartResult *res;
+   int *local;          // parent var -> sub literal, -1 if not extracted
+   vector<int> touched;
+};
+
+/*******************************************/
+/*   class CirMgr member functions: fraig  */
+/*******************************************/
+void CirMgr::fraigPartitioned() {
+   vector<FraigPartition> parts;
+   fraigPartCluster(parts);
+
+   int nthreads = std::min(fraig_threads, (int)parts.size());
+   printf("fraig: %d outputs in %d partitions of at most %d gates, "
+         "%d threads\n", nOutputs, (int)parts.size(), fraig_part_gates,
+         nthreads);
+
+   fraig_pi_pos = new int[nMaxVar+1];
+   for(int i = 0; i < nInputs; ++i)
+      fraig_pi_pos[inputs[i]->getVarId()] = i;
+
+   FraigPartResult res;
+   pthread_mutex_init(&res.mutex, NULL);
+   pthread_cond_init(&res.cond, NULL);
+   res.next_take = res.next_stitch = 0;
+   res.po_lit.resize(nOutputs);
+   res.strash = new Hash<VarHashKey, int>(nGates + 1);
+
+   FraigPartWorker *workers = new FraigPartWorker[nthreads];
+   for(int t = 0; t < nthreads; ++t) {
+      workers[t].mgr = this;
+      workers[t].parts = &parts;
+      workers[t].res = &res;
+      workers[t].local = new int[nMaxVar+1];
+      for(int i = 0; i <= nMaxVar; ++i)
+         workers[t].local[i] = -1;
+   }
+
+   // partitions are taken in order and wait only for earlier ones, which
+   // are being worked on: whatever threads start finish everything
+   int nstarted = 0;
+   bool started[nthreads];
+   for(int t = 0; t < nthreads; ++t)
+      if((started[t] = (pthread_create(&workers[t].thread, NULL,
+                     fraigPartThread, &workers[t]) == 0)))
+         nstarted++;
+   // no thread, fraig here
+   if(!nstarted) fraigPartWork(&workers[0]);
+   for(int t = 0; t < nthreads; ++t)
+      if(started[t]) pthread_join(workers[t].thread, NULL);
+
+   for(int t = 0; t < nthreads; ++t)
+      delete[] workers[t].local;
+   delete[] workers;
+   delete[] fraig_pi_pos;
+   fraig_pi_pos = NULL;
+   delete res.strash;
+   pthread_mutex_destroy(&res.mutex);
+   pthread_cond_destroy(&res.cond);
+
+   fraigPartReplace(res);
+}
+
+void *CirMgr::fraigPartThread(void *arg) {
+   FraigPartWorker *w = (FraigPartWorker *)arg;
+   w->mgr->fraigPartWork(w);
+   return NULL;
+}
+
+// runs on a worker thread: reads the netlist, writes only to w and the
+// result, the latter under its mutex
+void CirMgr::fraigPartWork(FraigPartWorker *w) {
+   FraigPartResult *res = w->res;
+   for(;;) {
+      pthread_mutex_lock(&res->mutex);
+      int i = res->next_take++;
+      pthread_mutex_unlock(&res->mutex);
+      if(i >= (int)w->parts->size()) break;
+
+      FraigPartition &p = w->parts->at(i);
+
+      CirMgr *sub = new CirMgr;
+      fraigPartExtract(w, p, *sub);
+
+      if(sub->getNumGates()) {
+         sub->setSatEffort(sat_effort);
+         sub->setFraigCexFlip(fraig_cex_flip);
+         sub->setFraigSweep(fraig_sweep);
+         sub->setFraigKeyPatterns(
+               sat_keypat_words*(int)sizeof(gateval_t)*8);
+
+         // what is left of the limits; past them the partition goes
+         // back as it was extracted
+         int msec = (fraig_deadline > 0.0) ?
+            std::max(1, (int)(fraig_deadline - wallClockMs())) : 0;
+         sub->setFraigLimits(msec, fraig_mem_limit);
+         if(!fraigOverLimits(true)) {
+            sub->randomSim();
+            sub->fraig();
+         }
+      }
+
+      sub->fraigPartExport(p);
+      delete sub;
+
+      pthread_mutex_lock(&res->mutex);
+      while(res->next_stitch != i)
+         pthread_cond_wait(&res->cond, &res->mutex);
+      fraigPartStitch(*res, p);
+      res->next_stitch++;
+      pthread_cond_broadcast(&res->cond);
+      pthread_mutex_unlock(&res->mutex);
+   }
+}
+
+// POs in order; each joins the partition owning most of its fanin cone
+// if that still fits, else opens a new one. a gate is owned by the first
+// partition that takes it, so the size of a partition is an upper bound.
+void CirMgr::fraigPartCluster(vector<FraigPartition> &parts) {
+   int *owner = new int[nMaxVar+1];
+   int *mark = new int[nMaxVar+1];
+   for(int i = 0; i <= nMaxVar; ++i) {
+      owner[i] = -1;
+      mark[i] = 0;
+   }
+
+   vector<int> size, hits, cone, touched;
+   for(int i = 0; i < nOutputs; ++i) {
+      cone.clear();
+      fraigPartConeDFS(mark, i+1, cone, outputs[i]->getIN0()>>1);
+
+      touched.clear();
+      for(int j = 0, n = cone.size(); j < n; ++j) {
+         int o = owner[cone[j]];
+         if(o < 0) continue;
+         if(!hits[o]++) touched.push_back(o);
+      }
+
+      int best = -1;
+      for(int j = 0, n = touched.size(); j < n; ++j) {
+         int o = touched[j];
+         if(size[o] + (int)cone.size() - hits[o] > fraig_part_gates)
+            continue;
+         if(best < 0 || hits[o] > hits[best]) best = o;
+      }
+      if(best < 0) {
+         best = parts.size();
+         parts.push_back(FraigPartition());
+         size.push_back(0);
+         hits.push_back(0);
+      }
+
+      parts[best].pos.push_back(i);
+      size[best] += cone.size() - hits[best];
+      for(int j = 0, n = cone.size(); j < n; ++j)
+         if(owner[cone[j]] < 0) owner[cone[j]] = best;
+
+      for(int j = 0, n = touched.size(); j < n; ++j)
+         hits[touched[j]] = 0;
+   }
+
+   delete[] owner;
+   delete[] mark;
+}
+
+// AIG gates in the fanin cone of varid not yet marked with stamp
+void CirMgr::fraigPartConeDFS(int *mark, int stamp, vector<int> &cone,
+      int varid) {
+   if(mark[varid] == stamp) return;
+   mark[varid] = stamp;
+
+   const CirVar *v = vars[varid];
+   if(v->getType() != AIG_GATE) return;
+
+   fraigPartConeDFS(mark, stamp, cone, v->getIN0()>>1);
+   fraigPartConeDFS(mark, stamp, cone, v->getIN1()>>1);
+   cone.push_back(varid);
+}
+
+// the fanin cones of p's POs as a circuit of its own, numbered like the
+// compact result: inputs first, then the gates in topological order
+void CirMgr::fraigPartExtract(FraigPartWorker *w, FraigPartition &p,
+      CirMgr &sub) {
+   vector<int> cone;
+   for(int i = 0, n = p.pos.size(); i < n; ++i)
+      fraigPartExtractDFS(w, cone, p.pis, outputs[p.pos[i]]->getIN0()>>1);
+
+   // inputs in parent order keep the simulation order stable
+   vector<pair<int, int> > order;
+   for(int i = 0, n = p.pis.size(); i < n; ++i)
+      order.push_back(make_pair(fraig_pi_pos[p.pis[i]], p.pis[i]));
+   sort(order.begin(), order.end());
+
+   int npis = order.size(), nands = cone.size();
+   p.pis.clear();
+   for(int i = 0; i < npis; ++i) {
+      p.pis.push_back(order[i].first);
+      w->local[order[i].second] = (i+1)<<1;
+   }
+   for(int i = 0; i < nands; ++i)
+      w->local[cone[i]] = (npis+1+i)<<1;
+
+   sub.initCircuit(npis+nands, npis, 0, p.pos.size(), nands);
+   for(int i = 0; i < npis; ++i) {
+      CirVar *pi = sub.addInput(i+1);
+      const CirVar *src = inputs[p.pis[i]];
+      if(src->hasSymbol()) pi->setSymbol(src->getSymbol());
+   }
+   for(int i = 0; i < nands; ++i) {
+      const CirVar *g = vars[cone[i]];
+      int in0 = g->getIN0(), in1 = g->getIN1();
+      sub.addGate(npis+1+i, w->local[in0>>1]^(in0&1),
+            w->local[in1>>1]^(in1&1));
+   }
+   for(int i = 0, n = p.pos.size(); i < n; ++i) {
+      int lit = outputs[p.pos[i]]->getIN0();
+      sub.addOutput(w->local[lit>>1]^(lit&1));
+   }
+   sub.finishCircuit();
+
+   for(int i = 0, n = w->touched.size(); i < n; ++i)
+      w->local[w->touched[i]] = -1;
+   w->touched.clear();
+}
+
+// collects gates (cone) and PI var ids (pis) of the fanin cone of varid
+// once each; local[] doubles as the visited mark
+void CirMgr::fraigPartExtractDFS(FraigPartWorker *w, vector<int> &cone,
+      vector<int> &pis, int varid) {
+   if(w->local[varid] != -1) return;
+   w->local[varid] = 0;
+   w->touched.push_back(varid);
+
+   const CirVar *v = vars[varid];
+   if(v->getType() == PI_GATE)
+      pis.push_back(varid);
+   else if(v->getType() == AIG_GATE) {
+      fraigPartExtractDFS(w, cone, pis, v->getIN0()>>1);
+      fraigPartExtractDFS(w, cone, pis, v->getIN1()>>1);
+      cone.push_back(varid);
+   }
+}
+
+// called on a fraiged partition: what the outputs still reach, compact
+void CirMgr::fraigPartExport(FraigPartition &p) {
+   int *lit = new int[nMaxVar+1];
+   for(int i = 0; i <= nMaxVar; ++i)
+      lit[i] = -1;
+   lit[0] = 0;
+   for(int i = 0; i < nInputs; ++i)
+      lit[inputs[i]->getVarId()] = (i+1)<<1;
+
+   p.ands.clear();
+   p.outs.clear();
+   for(int i = 0; i < nOutputs; ++i) {
+      int in0 = outputs[i]->getIN0();
+      p.outs.push_back(fraigPartExportDFS(p, lit, in0>>1)^(in0&1));
+   }
+
+   delete[] lit;
+}
+
+int CirMgr::fraigPartExportDFS(FraigPartition &p, int *lit, int varid) {
+   if(lit[varid] >= 0) return lit[varid];
+
+   const CirVar *v = vars[varid];
+   // undefined vars read as constant 0
+   if(v->getType() != AIG_GATE) return lit[varid] = 0;
+
+   int in0 = v->getIN0(), in1 = v->getIN1();
+   int l0 = fraigPartExportDFS(p, lit, in0>>1)^(in0&1);
+   int l1 = fraigPartExportDFS(p, lit, in1>>1)^(in1&1);
+
+   p.ands.push_back(l0);
+   p.ands.push_back(l1);
+   return lit[varid] = (nInputs + p.ands.size()/2) << 1;
+}
+
+// adds a fraiged partition to the result, hashing its gates against
+// what is in already, and frees its export
+void CirMgr::fraigPartStitch(FraigPartResult &res, FraigPartition &p) {
+   int np = p.pis.size(), na = p.ands.size()/2;
+
+   // compact var -> result literal
+   vector<int> lit(np + na + 1);
+   lit[0] = 0;
+   for(int j = 0; j < np; ++j)
+      lit[j+1] = (p.pis[j]+1)<<1;
+   for(int j = 0; j < na; ++j) {
+      int in0 = p.ands[2*j], in1 = p.ands[2*j+1];
+      int a = lit[in0>>1]^(in0&1), b = lit[in1>>1]^(in1&1);
+      if(a > b) std::swap(a, b);
+
+      int l;
+      if(a == 0 || a == (b^1)) l = 0;
+      else if(a == 1 || a == b) l = b;
+      else if(!res.strash->check(VarHashKey(a, b), l)) {
+         res.ands.push_back(a);
+         res.ands.push_back(b);
+         l = (nInputs + res.ands.size()/2) << 1;
+         res.strash->forceInsert(VarHashKey(a, b), l);
+      }
+      lit[np+1+j] = l;
+   }
+   for(int j = 0, m = p.pos.size(); j < m; ++j)
+      res.po_lit[p.pos[j]] = lit[p.outs[j]>>1]^(p.outs[j]&1);
+
+   // nothing of a partition is needed once it is in
+   FraigPartition().swap(p);
+}
+
+// the result replaces the netlist: inputs keep their var ids and symbols,
+// gates take the free ids in result order
+void CirMgr::fraigPartReplace(FraigPartResult &res) {
+   int nands = res.ands.size()/2;
+   int npis = nInputs, npos = nOutputs;
+   vector<int> pi_id(npis);
+   vector<string> pi_sym(npis), po_sym(npos);
+   int maxid = 0;
+   for(int i = 0; i < npis; ++i) {
+      pi_id[i] = inputs[i]->getVarId();
+      pi_sym[i] = inputs[i]->getSymbol();
+      maxid = std::max(maxid, pi_id[i]);
+   }
+   for(int i = 0; i < npos; ++i)
+      po_sym[i] = outputs[i]->getSymbol();
+
+   int M = std::max(maxid, npis + nands);
+   vector<bool> is_pi(M+1, false);
+   for(int i = 0; i < npis; ++i)
+      is_pi[pi_id[i]] = true;
+
+   deleteNetlist();
+   initCircuit(M, npis, 0, npos, nands);
+   for(int i = 0; i < npis; ++i) {
+      CirVar *pi = addInput(pi_id[i]);
+      if(pi_sym[i].size()) pi->setSymbol(pi_sym[i]);
+   }
+
+   // result var -> literal here
+   vector<int> lit(npis + nands + 1);
+   lit[0] = 0;
+   for(int i = 0; i < npis; ++i)
+      lit[i+1] = pi_id[i]<<1;
+   for(int i = 0, next = 1; i < nands; ++i) {
+      while(is_pi[next]) ++next;
+      int in0 = res.ands[2*i], in1 = res.ands[2*i+1];
+      addGate(next, lit[in0>>1]^(in0&1), lit[in1>>1]^(in1&1));
+      lit[npis+1+i] = (next++)<<1;
+   }
+   vector<int>().swap(res.ands);
+
+   for(int i = 0; i < npos; ++i) {
+      int l = res.po_lit[i];
+      CirVar *po = addOutput(lit[l>>1]^(l&1));
+      if(po_sym[i].size()) po->setSymbol(po_sym[i]);
+   }
+   finishCircuit();
+   // gates only a folded partition gate used
+   removeUnrefGates();
+
+   printf("fraig: stitched %d gates\n", getNumGates());
+}
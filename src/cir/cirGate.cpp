@@ -9,6 +9,7 @@
 #include <iostream>
 #include <iomanip>
 #include <stdarg.h>
+#include <cstring>
 #include <cassert>
 #include "cirMgr.h"
 #include "cirGate.h"
@@ -91,11 +92,21 @@ CirVar::reportGate() const
    } else
       printf("<not yet simulated>\n");
 
-   sprintf(buf, "Value: ");
-   char *p = &buf[strlen(buf)];
-   for(int i = sizeof(gateval_t)*8-1; i >= 0; --i)
-      *(p++) = ((val >> i) & 1) ? '1' : '0';
-   printf("= %s\n", buf);
+   // print the whole signature, one word per line
+   const gateval_t *sig = mgr.getSimSignature(getVarId());
+   int nwords = mgr.getSimSignatureFilled();
+   if(!sig || nwords == 0) {
+      sig = &val;
+      nwords = 1;
+   }
+   for(int w = nwords-1; w >= 0; --w) {
+      sprintf(buf, "%s", (w == nwords-1) ? "Value: " : "       ");
+      char *p = &buf[strlen(buf)];
+      for(int i = sizeof(gateval_t)*8-1; i >= 0; --i)
+         *(p++) = ((sig[w] >> i) & 1) ? '1' : '0';
+      *p = '\0';
+      printf("= %s\n", buf);
+   }
 
    printf("==================================================\n");
 }
@@ -178,3 +189,35 @@ void CirVar::reportFanoutDFS(int level, int maxlevel, int caller) const {
       printf("\n");
 }
 
+/***************************************/
+/*   class CirPairSet                  */
+/***************************************/
+bool CirPairSet::insert(int a, int b) {
+   if(2*(count + 1) > cap) grow();
+
+   uint64_t k = key(a, b);
+   size_t i = slot(k);
+   for(; slots[i]; i = (i + 1) & (cap - 1))
+      if(slots[i] == k) return false;
+
+   slots[i] = k;
+   count++;
+   return true;
+}
+
+void CirPairSet::grow() {
+   uint64_t *old = slots;
+   size_t old_cap = cap;
+
+   cap = cap ? cap*2 : 64;
+   slots = new uint64_t[cap];
+   memset(slots, 0, sizeof(uint64_t)*cap);
+
+   for(size_t j = 0; j < old_cap; ++j) {
+      if(!old[j]) continue;
+      size_t i = slot(old[j]);
+      while(slots[i]) i = (i + 1) & (cap - 1);
+      slots[i] = old[j];
+   }
+   if(old) delete[] old;
+}
@@ -9,8 +9,12 @@
 #ifndef CIR_GATE_H
 #define CIR_GATE_H
 
+#include <stdint.h>
 #include <string>
 #include <deque>
+#include <vector>
+#include <set>
+#include <cassert>
 
 using namespace std;
 
@@ -134,11 +138,6 @@ public:
    inline void setTopologicalOrder(int ord) { topo_ord = ord; }
    inline int  getTopologicalOrder() const { return topo_ord; }
 
-   inline void addBlacklist(int v) { fraig_blacklist.insert(v); }
-   inline bool isInBlacklist(int v) const {
-      return fraig_blacklist.find(v) != fraig_blacklist.end();
-   }
-
 protected:
    CirMgr &mgr;
    int id, line, symline, ref_count;
@@ -158,8 +157,6 @@ protected:
 
    int topo_ord;
 
-   set<int> fraig_blacklist;
-
    void reportFanoutDFS(int level, int maxlevel, int caller) const;
    void reportFaninDFS(int level, int maxlevel, bool inverted) const;
 };
@@ -245,4 +242,90 @@ private:
    int in0, in1;
 };
 
+// hash key over a multi-word simulation signature, taken in the given
+// phase. signatures are hashed in a canonical phase (bit 0 of word 0
+// cleared) unless canonical is false, so a signature and its complement
+// fall into the same entry; isInverted() tells the total phase applied.
+class SigHashKey
+{
+public:
+   SigHashKey(const gateval_t *sig, int nwords, bool phase = false,
+         bool canonical = true): sig(sig), nwords(nwords) {
+      bool inv = phase;
+      if(canonical && ((sig[0] & 1) != phase)) inv = !inv;
+      mask = inv ? ~(gateval_t)0 : 0;
+      hash = 0;
+      for(int i = 0; i < nwords; ++i)
+         hash = hash * 1000003 + ((sig[i] ^ mask) * 2654435761u);
+   }
+
+   bool isInverted() const { return mask != 0; }
+
+   size_t operator()() const { return hash; }
+
+   bool operator==(const SigHashKey& k) const {
+      if(hash != k.hash || nwords != k.nwords) return false;
+      for(int i = 0; i < nwords; ++i)
+         if((sig[i] ^ mask) != (k.sig[i] ^ k.mask)) return false;
+      return true;
+   }
+private:
+   const gateval_t *sig;
+   int nwords;
+   gateval_t mask;
+   size_t hash;
+};
+
+// set of unordered var pairs: open addressing over (min, max) packed
+// into one 64-bit word, linear probing, kept at most half full
+class CirPairSet
+{
+public:
+   CirPairSet(): slots(NULL), cap(0), count(0) {}
+   ~CirPairSet() { clear(); }
+
+   void clear() {
+      if(slots) delete[] slots;
+      slots = NULL;
+      cap = count = 0;
+   }
+
+   // false if the pair is already in
+   bool insert(int a, int b);
+   bool contains(int a, int b) const {
+      if(!count) return false;
+      uint64_t k = key(a, b);
+      for(size_t i = slot(k); slots[i]; i = (i + 1) & (cap - 1))
+         if(slots[i] == k) return true;
+      return false;
+   }
+
+   size_t size() const { return count; }
+   size_t memUsage() const { return sizeof(uint64_t)*cap; }
+   // every pair in, in no particular order
+   void getPairs(vector<pair<int, int> > &out) const {
+      for(size_t i = 0; i < cap; ++i)
+         if(slots[i])
+            out.push_back(make_pair((int)(slots[i] >> 32) - 1,
+                                    (int)(uint32_t)slots[i] - 1));
+   }
+
+private:
+   uint64_t *slots;   // 0 is an empty slot
+   size_t cap, count;
+
+   // ids are shifted by one so no pair packs to 0
+   static uint64_t key(int a, int b) {
+      if(a > b) { int t = a; a = b; b = t; }
+      return ((uint64_t)(a + 1) << 32) | (uint32_t)(b + 1);
+   }
+   size_t slot(uint64_t k) const {
+      k ^= k >> 33;
+      k *= 0xff51afd7ed558ccdULL;
+      k ^= k >> 33;
+      return (size_t)k & (cap - 1);
+   }
+   void grow();
+};
+
 #endif // CIR_GATE_H
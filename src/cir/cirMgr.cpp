@@ -15,6 +15,8 @@
 #include <cassert>
 #include <cstring>
 #include <cstdarg>
+#include <sys/time.h>
+#include <unistd.h>
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "myHash.h"
@@ -185,6 +187,22 @@ void CirParser::Debug(const char *msg, ...) {
 /*************************************/
 /*   class CirMgr member functions   */
 /*************************************/
+double CirMgr::wallClockMs() {
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// resident set size, 0 if unknown
+int CirMgr::residentMB() {
+   FILE *fp = fopen("/proc/self/statm", "r");
+   if(!fp) return 0;
+   long size = 0, rss = 0;
+   if(fscanf(fp, "%ld %ld", &size, &rss) != 2) rss = 0;
+   fclose(fp);
+   return (int)((double)rss * sysconf(_SC_PAGESIZE) / (1 << 20));
+}
+
 bool
 CirMgr::readCircuit(const string& fileName)
 {
@@ -212,6 +230,25 @@ bool CirMgr::initCircuit(int M, int I, int L, int O, int A) {
    return true;
 }
 
+void CirMgr::finishCircuit() {
+   // There may be some undefined variables, fix it!
+   fixNullVars();
+
+   calculateRefCount();
+   countFloating();
+
+   if(_noopt) {
+      printf("no opt set, skip merge trivial gates.\n");
+   } else {
+      printf("Merging trivial gates...\n");
+      mergeTrivial();
+   }
+
+   SatSetupInputs();
+
+   buildRevRef();
+}
+
 CirVar *CirMgr::addInput(int varid) {
    if(iInput >= nInputs) return NULL;
 
@@ -296,22 +333,7 @@ bool CirParser::parseFileContent() {
    for(int i = mgr.getNumGates()-1; i >= 0; --i)
       if(!parseGate()) return false;
 
-   // There may be some undefined variables, fix it!
-   mgr.fixNullVars();
-
-   mgr.calculateRefCount();
-   mgr.countFloating();
-
-   if(mgr._noopt) {
-      printf("no opt set, skip merge trivial gates.\n");
-   } else {
-      printf("Merging trivial gates...\n");
-      mgr.mergeTrivial();
-   }
-
-   mgr.SatSetupInputs();
-
-   mgr.buildRevRef();
+   mgr.finishCircuit();
 
    int nxt = ifs.peek();
    while(nxt != EOF) {
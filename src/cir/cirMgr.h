@@ -16,11 +16,21 @@
 #include <fstream>
 
 #include "cirGate.h"
+#include "cirSimGen.h"
+#include "cirSimLog.h"
+#include "cirPattern.h"
+#include "cirCut.h"
+#include "cirCheckpoint.h"
 #include "myHash.h"
 
 #include "sat.h"
 
 //class CirAigGate;
+struct FraigParPair;
+struct FraigParWorker;
+struct FraigPartition;
+struct FraigPartWorker;
+struct FraigPartResult;
 
 using namespace std;
 
@@ -31,6 +41,13 @@ enum SATSolveEffort {
    EFFORT_UNLIMITED
 };
 
+// roots of the gates simulation evaluates
+enum SimConeRoot {
+   SIM_CONE_ALL = 1,    // every gate
+   SIM_CONE_FEC = 2,    // members of FEC groups
+   SIM_CONE_PO  = 4     // fanin cones of POs
+};
+
 // TODO: You are free to define data members and member functions on your own
 class CirMgr
 {
@@ -42,20 +59,98 @@ public:
    CirMgr() {
       is_debug = false;
 
+      nMaxVar = nInputs = nOutputs = nGates = 0;
+      vars = inputs = outputs = gates = NULL;
+
       _simLog = NULL;
+      sim_log = NULL;
+      sim_log_async = false;
+      sim_no_fec = false;
+      sim_corpus = NULL;
+      sim_cone_val = NULL;
+      sim_cone_roots = sim_cone_members = 0;
+
+      fec_exact = false;
+      sim_exact_seen = NULL;
+      fec_scope = NULL;
+
+      fraig_cone_val = NULL;
+      fraig_cone_mark = NULL;
+      fraig_pi_pos = NULL;
+      fraig_level = NULL;
+      fraig_sched_cost = NULL;
+      fraig_strash = NULL;
+      fraig_cut_proved = fraig_cut_refuted = 0;
+      fraig_cone_stamp = 0;
 
       rev_ref = NULL;
       fec_groups = NULL;
 
+      sim_sig = NULL;
+      sim_sig_words = 8;
+      sim_sig_pos = sim_sig_filled = 0;
+
+      sim_gen = NULL;
+      sim_keep_next = 0;
+
       sat_var = NULL;
+      sat_added = NULL;
       sat_keypat = NULL;
       sat_keypat_size = 0;
+      sat_keypat_words = 8;
 
       sat_effort = EFFORT_MED;
       surrender = 20;
+      sat_conflict_budget = 10000;
+      sat_prop_budget = 1<<26;
+      sat_undecided = 0;
+
+      sim_time_budget = 0;
+      sim_patt_budget = 0;
+      sat_calls = 0;
+      sat_time = 0.0;
+
+      fraig_cex_flip = false;
+      fraig_threads = 1;
+      fraig_sweep = false;
+      fraig_part_gates = 0;
+      fraig_flip_cursor = 0;
+
+      fraig_time_limit = fraig_mem_limit = 0;
+      fraig_deadline = 0.0;
+      fraig_limit_tick = 0;
+      fraig_stopped = false;
+
+      fraig_ckpt_interval = 60;
+      fraig_ckpt_last = 0.0;
+      fraig_ckpt = NULL;
    }
    ~CirMgr() { deleteCircuit(); }
    void deleteCircuit() {
+      deleteNetlist();
+
+      if(sim_corpus) {
+         delete sim_corpus;
+         sim_corpus = NULL;
+      }
+
+      if(sim_gen) {
+         delete sim_gen;
+         sim_gen = NULL;
+      }
+      sim_keep_patts.clear();
+
+      if(sat_keypat) {
+         delete[] sat_keypat;
+         sat_keypat = NULL;
+      }
+   }
+   // the gates and everything sized by or keyed on their var ids;
+   // stimulus and stored patterns, which only depend on the PIs, stay
+   void deleteNetlist() {
+      fraig_blacklist.clear();
+      fraig_undecided.clear();
+
       if(fec_groups) {
          for(int i = 0, n = fec_groups->size(); i < n; ++i)
             delete fec_groups->at(i);
@@ -63,22 +158,53 @@ public:
          fec_groups = NULL;
       }
 
+      if(sim_sig) {
+         delete[] sim_sig;
+         sim_sig = NULL;
+      }
+
+      sim_cone.clear();
+      if(sim_cone_val) {
+         delete[] sim_cone_val;
+         sim_cone_val = NULL;
+      }
+
+      fec_exact = false;
+      if(sim_exact_seen) {
+         delete[] sim_exact_seen;
+         sim_exact_seen = NULL;
+      }
+
+      if(fec_scope) {
+         delete[] fec_scope;
+         fec_scope = NULL;
+      }
+
       if(sat_var) {
          delete[] sat_var;
          sat_var = NULL;
       }
 
-      if(sat_keypat) {
-         delete[] sat_keypat;
-         sat_keypat = NULL;
+      if(sat_added) {
+         delete[] sat_added;
+         sat_added = NULL;
+      }
+      sat_keypat_size = 0;
+
+      if(rev_ref) {
+         delete[] rev_ref;
+         rev_ref = NULL;
       }
 
       if(vars) {
          for(int i = 0; i <= nMaxVar; ++i)
             delete vars[i];
          delete[] vars;
+         delete[] inputs;
+         delete[] gates;
          vars = NULL;
          inputs = NULL;
+         gates = NULL;
       }
 
       if(outputs) {
@@ -130,6 +256,8 @@ public:
    CirVar *addGate(int varid, int in0, int in1);
 
    void fixNullVars();
+   // what the parser does once the gates are in
+   void finishCircuit();
 
    // Member functions about circuit optimization
    static void setNoOpt(bool noopt) { _noopt = noopt; }
@@ -148,22 +276,83 @@ public:
 
    // Member functions about fraig
    void strash();
-   void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   void setSimLog(ofstream *logFile, bool async = false) {
+      _simLog = logFile;
+      sim_log_async = async;
+   }
+   void setSimSeed(unsigned seed) { sim_rng.setSeed(seed); }
+   // PO responses only: no signatures, no FEC refinement
+   void setSimNoFec(bool f) { sim_no_fec = f; }
+   // record patterns that split FEC groups from now on (also during
+   // fraig) into a packed pattern file; empty name stops recording
+   bool setSimCorpus(const string &file);
+   void setSimPatternGen(SimPatternMode mode, int weight = 128);
+   void keepSimulationPattern(const char *patt);
+   // 0 means no budget, randomSim then stops adaptively
+   void setSimBudget(int msec, int patterns) {
+      sim_time_budget = msec;
+      sim_patt_budget = patterns;
+   }
    void randomSim();
    void fileSim(ifstream&);
+   bool exhaustiveSim();
    bool simulatePattern(const char *patt, char *result);
    void fraig();
+   void setFraigCexFlip(bool f) { fraig_cex_flip = f; }
+   void setFraigThreads(int n) { fraig_threads = n; }
+   void setFraigSweep(bool f) { fraig_sweep = f; }
+   // >0: fraig output clusters of about this many gates on their own
+   void setFraigPartition(int gates) { fraig_part_gates = gates; }
+   // 0 means no limit. once one is reached fraig stops proving, applies
+   // the merges it has and leaves a consistent netlist
+   void setFraigLimits(int msec, int mb) {
+      fraig_time_limit = msec;
+      fraig_mem_limit = mb;
+   }
+   // fraig only the fanin cones of these gate ids (POs included); empty
+   // means the whole circuit. false if an id is not a gate
+   bool setFraigScope(const vector<int> &gids);
+   // checkpoint fraig state to file every interval seconds; empty name
+   // turns checkpoints off
+   void setFraigCheckpoint(const string &file, int interval) {
+      fraig_ckpt_file = file;
+      fraig_ckpt_interval = interval;
+   }
+   // FEC groups, blacklist and patterns of a checkpoint whose netlist
+   // this manager has just read
+   bool fraigLoadCheckpoint(const string &fileName);
+   // counterexamples buffered before resimulation, rounded up to words
+   void setFraigKeyPatterns(int n);
    void setSatEffort(SATSolveEffort ef) {
       switch(sat_effort = ef) {
-         case EFFORT_LOW: surrender = 5; break;
-         case EFFORT_MED: surrender = 20; break;
-         case EFFORT_HIGH: surrender = 50; break;
+         case EFFORT_LOW: surrender = 5;
+            sat_conflict_budget = 1000; sat_prop_budget = 1<<22; break;
+         case EFFORT_MED: surrender = 20;
+            sat_conflict_budget = 10000; sat_prop_budget = 1<<26; break;
+         case EFFORT_HIGH: surrender = 50;
+            sat_conflict_budget = 100000; sat_prop_budget = 1<<30; break;
          default: surrender = 100;
+            sat_conflict_budget = -1; sat_prop_budget = -1;
       }
    }
+   void setSimSignatureWords(int n);
+   int  getSimSignatureWords() const { return sim_sig_words; }
+   int  getSimSignatureFilled() const { return sim_sig_filled; }
+   const gateval_t *getSimSignature(int varid) const {
+      if(!sim_sig || varid < 0 || varid > nMaxVar) return NULL;
+      return &sim_sig[varid*sim_sig_words];
+   }
+   bool simSignatureMatch(int v0, int v1, bool inv_flag) const;
+
    void SatStoreKeyPattern();
-   inline bool SatIsKeyPatternStorageFull() const;
+   void SatStoreKeyPattern(const char *bits);
+   gateval_t *SatNewKeyPattern();
+   bool SatPendingSeparates(int v0, int v1, bool inv_flag);
+   bool SatIsKeyPatternStorageFull() const {
+      return sat_keypat_size == (int)(sizeof(gateval_t)*8)*sat_keypat_words;
+   }
    int SatSimulateKeyPatterns();
+   int SatSimulateCexNeighbors();
 
    void initFecGroups();
    int  FecGrouping();
@@ -184,6 +373,9 @@ private:
    // lists of pi, po, aig, total, dfs, floating, FEC...
    // Simulation, fraig related...
    ofstream    *_simLog;
+   // buffered writer on _simLog while a simulation runs
+   CirSimLogWriter *sim_log;
+   bool         sim_log_async;
    static bool  _noopt;
 
 
@@ -204,18 +396,106 @@ private:
    SATSolveEffort sat_effort;
    FECGrp *fec_groups;
 
+   // N-word simulation signature per var, refined once every N words
+   gateval_t *sim_sig;
+   int sim_sig_words, sim_sig_pos, sim_sig_filled;
+
+   // stimulus for randomSim; NULL means plain sim_rng
+   CirRandomGen sim_rng;
+   CirPatternGen *sim_gen;
+   // recent patterns kept as bases for distance-1 flipping
+   vector<string> sim_keep_patts;
+   int sim_keep_next;
+
+   // PO responses only (-NoFEC)
+   bool sim_no_fec;
+
+   // distinguishing patterns go here while recording
+   CirBinPatternWriter *sim_corpus;
+
+   // AIG gates a simulation word evaluates, in topological order, and
+   // their values for the current word. built from SimConeRoot roots;
+   // members is the #FEC members it was built for.
+   vector<int> sim_cone;
+   gateval_t *sim_cone_val;
+   int sim_cone_roots, sim_cone_members;
+
+   // all input patterns simulated: FEC groups are exact classes. bit 0/1
+   // of sim_exact_seen[var] tells whether the var ever evaluated to 0/1
+   bool fec_exact;
+   char *sim_exact_seen;
+   // set: only the vars marked take part in FEC groups and simulation
+   char *fec_scope;
+
    SatSolver sat_solver;
    Var *sat_var;
+   // vars in the solver: gates with their CNF, inputs as decision vars
+   bool *sat_added;
 
+   // counterexamples waiting for resimulation, sat_keypat_words words
+   // per PI
    gateval_t *sat_keypat;
-   int sat_keypat_size;
+   int sat_keypat_size, sat_keypat_words;
    int sat_merged;
 
    int fraig_dfs_leave;
    vector<pair<int, int> > fraig_sim_pairs;
 
+   // joint fanin cone of a candidate pair, simulated exhaustively when
+   // its support is small
+   vector<int> fraig_cone, fraig_cone_pis;
+   gateval_t *fraig_cone_val;
+   int *fraig_cone_mark, fraig_cone_stamp;
+   // position of each PI in inputs
+   int *fraig_pi_pos;
+   // logic level of each var fraigDFS is done with, and what queries
+   // against it as representative have cost so far
+   int *fraig_level, *fraig_sched_cost;
+   // pairs fraig does not try again: not separated by their own
+   // counterexample. out of SAT effort, only for the current fraig
+   CirPairSet fraig_blacklist;
+   CirPairSet fraig_undecided;
+   // fanins -> gate, updated as fraig rewires
+   Hash<VarHashKey, int> *fraig_strash;
+   // cuts with truth tables, to decide local pairs without SAT
+   CirCutMgr fraig_cuts;
+   int fraig_cut_proved, fraig_cut_refuted;
+
+   // simulate distance-1 neighbors of each SAT model right away
+   bool fraig_cex_flip;
+   // >1: prove candidate pairs on this many threads before fraigDFS
+   int fraig_threads;
+   // one topological pass instead of fraigDFS rounds from the outputs
+   bool fraig_sweep;
+   int fraig_part_gates;
+   int fraig_flip_cursor;
+   // wall-clock (ms) and resident memory (MB) limits of a fraig run
+   int fraig_time_limit, fraig_mem_limit;
+   double fraig_deadline;
+   int fraig_limit_tick;
+   bool fraig_stopped;
+   // gate ids fraig is scoped to
+   vector<int> fraig_scope;
+   string fraig_ckpt_file;
+   int fraig_ckpt_interval;
+   double fraig_ckpt_last;
+   CirCheckpointWriter *fraig_ckpt;
+
    // use for effort setting
    int surrender;
+   // per SAT query, negative means no limit; pairs that ran out
+   int64 sat_conflict_budget, sat_prop_budget;
+   int sat_undecided;
+
+   // randomSim budgets, and SAT cost observed so far
+   int sim_time_budget, sim_patt_budget;
+   int sat_calls;
+   double sat_time;
+
+   static double wallClockMs();
+   static int residentMB();
+   double estimateSatCostMs() const;
+   int countFecMembers() const;
 
    void refCountDFS(bool *visited, int varid);
    int countValidGates() const;
@@ -223,12 +503,59 @@ private:
    int mergeTrivialDFS(bool *visited, int litid);
    int strashDFS(bool *visited, Hash<VarHashKey, int> &h, int litid);
 
-   int  fraigDFS(int &dfn, bool *visited, int *eqlit, int litid);
+   int  fraigDFS(int &dfn, char *visited, int *eqlit, int litid);
+   int  fraigConeExhaustive(int v0, int v1, bool inv_flag, bool keep_cex);
+   int  fraigCutMatch(int v0, int v1, bool inv_flag, bool keep_cex);
+   void fraigScopeInit();
+   void fraigScopeDFS(int varid);
+   bool fraigSkipPair(int v0, int v1) const {
+      return fraig_blacklist.contains(v0, v1) ||
+         fraig_undecided.contains(v0, v1);
+   }
+   bool fraigOverLimits(bool check_mem) const;
+   bool fraigOutOfBudget();
+   void fraigCheckpoint(bool force, const int *eqlit = NULL);
+   bool fraigCheckpointError(const string &fileName);
+   bool fraigConeDFS(int varid);
+   void fraigStrashInit();
+   int  fraigStrashLookup(const int *eqlit, int varid,
+         const char *visited = NULL);
+   void fraigPendingConeDFS(int varid);
+   void fraigMergeGate(int &dfn, const char *visited, int *eqlit,
+         int varid);
+   void fraigSweep();
+   int  fraigResolveLit(const int *eqlit, int litid);
+   void fraigRankCandidates(const vector<int> *s, int varid,
+         const char *visited, const int *eqlit, vector<int> &cand);
    void SatSetupInputs();
    void SatAddGate(CirVar *v);
-   void SatAddGateDFS(bool *visited, CirVar *v);
-   bool SatSolveVarEQ(int v0, int v1, bool inv_flag);
+   void SatLoadCone(int varid);
+   int  SatModelBit(int varid);
+   void SatAddMerge(int varid, int lit);
+   int  SatSolveVarEQ(int v0, int v1, bool inv_flag);
+   void SatRecordUndecided(int v0, int v1);
    void SatBlacklistNonseparatedVars();
+   void fraigParallel();
+   static void *fraigParThread(void *arg);
+   void fraigParWork(FraigParWorker *w);
+   void fraigParLoad(FraigParWorker *w, int varid);
+   void fraigParOrderDFS(int *ord, int &n, int varid);
+   void fraigParCollectPairs(const int *ord, vector<FraigParPair> &pairs);
+   int  fraigParMergeDFS(bool *visited, int *eqlit, int litid);
+   void fraigPartitioned();
+   static void *fraigPartThread(void *arg);
+   void fraigPartWork(FraigPartWorker *w);
+   void fraigPartCluster(vector<FraigPartition> &parts);
+   void fraigPartConeDFS(int *mark, int stamp, vector<int> &cone,
+         int varid);
+   void fraigPartExtract(FraigPartWorker *w, FraigPartition &p,
+         CirMgr &sub);
+   void fraigPartExtractDFS(FraigPartWorker *w, vector<int> &cone,
+         vector<int> &pis, int varid);
+   void fraigPartExport(FraigPartition &p);
+   int  fraigPartExportDFS(FraigPartition &p, int *lit, int varid);
+   void fraigPartStitch(FraigPartResult &res, FraigPartition &p);
+   void fraigPartReplace(FraigPartResult &res);
    void fraigReducePairs();
    bool fraigReducePairsLoop(int *reducible);
    int  fraigReducePairsDFS(bool *visited, int *reducible, int litid);
@@ -239,11 +566,18 @@ private:
    void countFloating();
 
    bool simuationError(const char *msgfmt, ...);
-   void simulationResult(const char *patt, const char *result);
 
-   bool checkSimulationPattern(const char *patt);
-   void pushSimulationPattern(const char *patt, gateval_t *vin);
-   int  simulate(gateval_t *vin, char **result);
+   void unpackSimulationPatterns(const gateval_t *vin, char **pattern);
+   void simulateWord(gateval_t *vin, gateval_t *vout);
+   int  simulate(gateval_t *vin, gateval_t *vout);
+   void buildSimCone(int roots);
+   void buildSimConeDFS(bool *visited, int varid);
+   void clearSimCone();
+   void evaluateSimCone(const gateval_t *vin, gateval_t *vout);
+   int  refineFecGroups();
+   void markSplittingPatterns(const vector<vector<int> *> &conts,
+         int nwords, gateval_t *useful) const;
+   void saveSplittingPatterns(const gateval_t *useful, int nwords);
 };
 
 class CirParser
@@ -0,0 +1,372 @@
+/****************************************************************************
+  FileName     [ cirPattern.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern file readers ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+#include "cirPattern.h"
+
+using namespace std;
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static const int W = sizeof(gateval_t)*8;
+
+// initial size of the text read buffer
+#define TEXT_BUF_SIZE (1<<20)
+
+static bool isLittleEndian() {
+   const uint32_t one = 1;
+   return *(const char *)&one == 1;
+}
+
+// transpose by swapping off-diagonal blocks of halving size:
+// bit (c+j) of a[k] <-> bit c of a[k+j]
+void transposeWords(gateval_t *a) {
+   gateval_t m = (~(gateval_t)0) >> (W/2);
+   for(int j = W/2; j != 0; j >>= 1, m ^= (m << j)) {
+      for(int k = 0; k < W; k = ((k | j) + 1) & ~j) {
+         gateval_t t = ((a[k] >> j) ^ a[k | j]) & m;
+         a[k] ^= t << j;
+         a[k | j] ^= t;
+      }
+   }
+}
+
+/***************************************/
+/*   class CirPatternReader            */
+/***************************************/
+bool CirPatternReader::setError(const char *unit, long long pos,
+      const char *msg) {
+   char buf[64];
+   sprintf(buf, "%s %lld", unit, pos);
+   has_error = true;
+   error_pos = buf;
+   error_msg = msg;
+   return false;
+}
+
+bool CirPatternReader::isBinaryFile(ifstream &ifs) {
+   char magic[4];
+   ifs.read(magic, 4);
+   bool ret = (ifs.gcount() == 4 && memcmp(magic, CIR_PATT_MAGIC, 4) == 0);
+   ifs.clear();
+   ifs.seekg(0, ios::beg);
+   return ret;
+}
+
+/***************************************/
+/*   class CirTextPatternReader        */
+/***************************************/
+CirTextPatternReader::CirTextPatternReader(ifstream &ifs, int nin):
+   CirPatternReader(ifs, nin) {
+   buf_size = TEXT_BUF_SIZE;
+   if(buf_size < 2*(nin+2)) buf_size = 2*(nin+2);
+   buf = new char[buf_size];
+   buf_begin = buf_end = 0;
+   eof = false;
+   line = 0;
+
+   nwords_per_row = (nin + W - 1) / W;
+   if(nwords_per_row == 0) nwords_per_row = 1;
+   rows = new gateval_t[W * nwords_per_row];
+}
+
+CirTextPatternReader::~CirTextPatternReader() {
+   delete[] buf;
+   delete[] rows;
+}
+
+// return the next line (not terminated) or NULL; valid until next call
+const char *CirTextPatternReader::nextLine(int &len) {
+   for(;;) {
+      char *b = &buf[buf_begin];
+      char *nl = (char *)memchr(b, '\n', buf_end - buf_begin);
+      if(nl) {
+         len = nl - b;
+         buf_begin += len + 1;
+         line++;
+         return b;
+      }
+
+      if(eof) {
+         if(buf_begin == buf_end) return NULL;
+         // last line without a newline
+         len = buf_end - buf_begin;
+         buf_begin = buf_end;
+         line++;
+         return b;
+      }
+
+      // move the partial line to the front, grow if it fills the buffer
+      int rest = buf_end - buf_begin;
+      if(buf_begin > 0) {
+         memmove(buf, b, rest);
+         buf_begin = 0;
+         buf_end = rest;
+      }
+      if(buf_end == buf_size) {
+         char *nbuf = new char[buf_size*2];
+         memcpy(nbuf, buf, buf_end);
+         delete[] buf;
+         buf = nbuf;
+         buf_size *= 2;
+      }
+
+      ifs.read(&buf[buf_end], buf_size - buf_end);
+      buf_end += ifs.gcount();
+      if(!ifs) eof = true;
+   }
+}
+
+// pack a line into words, bit b of row[w] is char (w*W + b)
+bool CirTextPatternReader::packRow(const char *p, int len, gateval_t *row) {
+   if(len != nin)
+      return setError("line", line,
+            "pattern length not equal to input length");
+
+   static const bool fast = isLittleEndian();
+   const uint64_t zeros = 0x3030303030303030ULL;
+   const uint64_t ones  = 0x0101010101010101ULL;
+
+   for(int w = 0; w < nwords_per_row; ++w) {
+      int base = w*W, n = nin - base;
+      if(n > W) n = W;
+
+      gateval_t v = 0;
+      int b = 0;
+
+      // 8 chars at a time: subtract '0' from every byte, any byte other
+      // than 0/1 (or a borrow from one below '0') leaves stray bits; the
+      // multiply gathers bit 0 of byte i into bit 56+i
+      if(fast) {
+         for(; b + 8 <= n; b += 8) {
+            uint64_t x;
+            memcpy(&x, &p[base+b], 8);
+            x -= zeros;
+            if(x & ~ones)
+               return setError("line", line,
+                     "pattern should contains 0/1 only");
+            v |= (gateval_t)((x * 0x0102040810204080ULL) >> 56) << b;
+         }
+      }
+      for(; b < n; ++b) {
+         unsigned c = (unsigned char)p[base+b] - '0';
+         if(c > 1)
+            return setError("line", line, "pattern should contains 0/1 only");
+         v |= (gateval_t)c << b;
+      }
+
+      row[w] = v;
+   }
+   return true;
+}
+
+int CirTextPatternReader::readBlock(gateval_t *vin) {
+   if(has_error) return 0;
+
+   int count = 0, len;
+   const char *p;
+
+   while(count < W && (p = nextLine(len))) {
+      if(!packRow(p, len, &rows[count*nwords_per_row])) break;
+      count++;
+   }
+   if(count == 0) return 0;
+
+   gateval_t a[W];
+   for(int w = 0; w < nwords_per_row; ++w) {
+      // pattern k goes to bit (W-1-k) of every input word
+      for(int k = 0; k < W; ++k)
+         a[W-1-k] = (k < count) ? rows[k*nwords_per_row+w] : 0;
+
+      transposeWords(a);
+
+      for(int b = 0, base = w*W; b < W && base+b < nin; ++b)
+         vin[base+b] = a[b];
+   }
+
+   return count;
+}
+
+/***************************************/
+/*   class CirBinPatternReader         */
+/***************************************/
+bool CirBinPatternReader::readHeader() {
+   char magic[4];
+   uint32_t version, bits, ninputs;
+   uint64_t npatt;
+
+   header_read = true;
+
+   ifs.read(magic, 4);
+   ifs.read((char *)&version, sizeof(version));
+   ifs.read((char *)&bits, sizeof(bits));
+   ifs.read((char *)&ninputs, sizeof(ninputs));
+   ifs.read((char *)&npatt, sizeof(npatt));
+
+   if(!ifs || memcmp(magic, CIR_PATT_MAGIC, 4) != 0)
+      return setError("pattern", 0, "invalid binary pattern header");
+   if(version != CIR_PATT_VERSION)
+      return setError("pattern", 0, "unsupported binary pattern version");
+   if((int)bits != W)
+      return setError("pattern", 0, "binary pattern word size mismatch");
+   if((int)ninputs != nin)
+      return setError("pattern", 0,
+            "pattern length not equal to input length");
+
+   remaining = npatt;
+   return true;
+}
+
+int CirBinPatternReader::readBlock(gateval_t *vin) {
+   if(has_error) return 0;
+   if(!header_read && !readHeader()) return 0;
+   if(remaining == 0) return 0;
+
+   ifs.read((char *)vin, sizeof(gateval_t)*nin);
+   if(ifs.gcount() != (streamsize)(sizeof(gateval_t)*nin)) {
+      setError("pattern", read_count+1, "unexpected end of pattern file");
+      return 0;
+   }
+
+   int count = (remaining < (uint64_t)W) ? (int)remaining : W;
+   remaining -= count;
+   read_count += count;
+   return count;
+}
+
+/***************************************/
+/*   class CirBinPatternWriter         */
+/***************************************/
+// offset of the pattern count in the header
+#define CIR_PATT_COUNT_POS (4 + 3*sizeof(uint32_t))
+
+bool CirBinPatternWriter::open(const char *file, int nin) {
+   close();
+
+   ofs.open(file, ios::out | ios::binary | ios::trunc);
+   if(!ofs) return false;
+
+   uint32_t version = CIR_PATT_VERSION, bits = W, ninputs = nin;
+   npatt = 0;
+   ofs.write(CIR_PATT_MAGIC, 4);
+   ofs.write((const char *)&version, sizeof(version));
+   ofs.write((const char *)&bits, sizeof(bits));
+   ofs.write((const char *)&ninputs, sizeof(ninputs));
+   ofs.write((const char *)&npatt, sizeof(npatt));
+
+   this->nin = nin;
+   count = 0;
+   block = new gateval_t[nin > 0 ? nin : 1];
+   memset(block, 0, sizeof(gateval_t)*nin);
+   block_pos = ofs.tellp();
+   return true;
+}
+
+void CirBinPatternWriter::close() {
+   if(!block) return;
+
+   sync();
+   ofs.close();
+   delete[] block;
+   block = NULL;
+}
+
+void CirBinPatternWriter::writeBlock() {
+   ofs.seekp(block_pos);
+   ofs.write((const char *)block, sizeof(gateval_t)*nin);
+}
+
+void CirBinPatternWriter::addPattern(const gateval_t *vin, int b) {
+   for(int i = 0; i < nin; ++i)
+      block[i] |= ((vin[i] >> b) & 1) << (W-1-count);
+   npatt++;
+
+   if(++count == W) {
+      writeBlock();
+      block_pos = ofs.tellp();
+      memset(block, 0, sizeof(gateval_t)*nin);
+      count = 0;
+   }
+}
+
+void CirBinPatternWriter::addBlock(const gateval_t *vin, int n) {
+   assert(count == 0 && n > 0 && n <= W);
+
+   memcpy(block, vin, sizeof(gateval_t)*nin);
+   npatt += n;
+   count = n;
+
+   if(count == W) {
+      writeBlock();
+      block_pos = ofs.tellp();
+      memset(block, 0, sizeof(gateval_t)*nin);
+      count = 0;
+   }
+}
+
+void CirBinPatternWriter::sync() {
+   if(!block) return;
+
+   if(count > 0) writeBlock();
+   ofs.seekp(CIR_PATT_COUNT_POS, ios::beg);
+   ofs.write((const char *)&npatt, sizeof(npatt));
+   ofs.flush();
+}
+
+/***************************************/
+/*   Pattern file conversion           */
+/***************************************/
+bool packPatternFile(const char *textFile, const char *binFile) {
+   ifstream ifs(textFile, ios::in | ios::binary);
+   if(!ifs) {
+      fprintf(stderr, "[ERROR] Cannot open file %s\n", textFile);
+      return false;
+   }
+
+   // the first line tells the number of inputs
+   string first;
+   getline(ifs, first);
+   ifs.clear();
+   ifs.seekg(0, ios::beg);
+   if(first.empty()) {
+      fprintf(stderr, "[ERROR] %s: empty pattern file\n", textFile);
+      return false;
+   }
+   int nin = first.size();
+
+   CirBinPatternWriter wr;
+   if(!wr.open(binFile, nin)) {
+      fprintf(stderr, "[ERROR] Cannot open file %s\n", binFile);
+      return false;
+   }
+
+   CirTextPatternReader rd(ifs, nin);
+   gateval_t *vin = new gateval_t[nin];
+   int n;
+   while((n = rd.readBlock(vin)) > 0)
+      wr.addBlock(vin, n);
+   delete[] vin;
+
+   if(rd.failed()) {
+      fprintf(stderr, "[ERROR] %s, %s: %s\n", textFile,
+            rd.getErrorPos().c_str(), rd.getErrorMsg().c_str());
+      wr.close();
+      remove(binFile);
+      return false;
+   }
+
+   uint64_t npatt = wr.getPatternCount();
+   wr.close();
+
+   printf("%llu pattern(s) of %d input(s) packed into %s\n",
+         (unsigned long long)npatt, nin, binFile);
+   return true;
+}
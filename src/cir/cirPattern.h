@@ -0,0 +1,142 @@
+/****************************************************************************
+  FileName     [ cirPattern.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern file readers ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_PATTERN_H
+#define CIR_PATTERN_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+
+#include "cirGate.h"
+
+using namespace std;
+
+// Packed binary pattern file (host byte order):
+//
+//    char[4]   magic "FRPT"
+//    uint32    version (1)
+//    uint32    bits per word (sizeof(gateval_t)*8)
+//    uint32    number of inputs
+//    uint64    number of patterns
+//
+// followed by ceil(#patterns / bits) blocks of #inputs words each, that
+// is, exactly the vin[] passed to simulation. pattern k of a block is
+// bit (bits-1-k) of every word; unused bits of the last block are 0.
+#define CIR_PATT_MAGIC    "FRPT"
+#define CIR_PATT_VERSION  1
+
+// readers hand out one word-transposed block of patterns at a time,
+// laid out as described above
+class CirPatternReader
+{
+public:
+   CirPatternReader(ifstream &ifs, int nin):
+      ifs(ifs), nin(nin), has_error(false) {}
+   virtual ~CirPatternReader() {}
+
+   // return #patterns in vin, 0 at end of file or on error
+   virtual int readBlock(gateval_t *vin) = 0;
+
+   bool failed() const { return has_error; }
+   // e.g. "line 12" or "pattern 4097"
+   const string &getErrorPos() const { return error_pos; }
+   const string &getErrorMsg() const { return error_msg; }
+
+   static bool isBinaryFile(ifstream &ifs);
+
+protected:
+   ifstream &ifs;
+   int nin;
+
+   bool has_error;
+   string error_pos, error_msg;
+
+   bool setError(const char *unit, long long pos, const char *msg);
+};
+
+// text patterns: one line of '0'/'1' per pattern. lines are scanned from
+// a large buffer, packed 8 chars at a time and bit-matrix transposed.
+class CirTextPatternReader: public CirPatternReader
+{
+public:
+   CirTextPatternReader(ifstream &ifs, int nin);
+   ~CirTextPatternReader();
+
+   int readBlock(gateval_t *vin);
+
+private:
+   char *buf;
+   int buf_size, buf_begin, buf_end;
+   bool eof;
+   int line;
+
+   // packed rows of the current block, nwords_per_row words per pattern
+   gateval_t *rows;
+   int nwords_per_row;
+
+   const char *nextLine(int &len);
+   bool packRow(const char *p, int len, gateval_t *row);
+};
+
+class CirBinPatternReader: public CirPatternReader
+{
+public:
+   CirBinPatternReader(ifstream &ifs, int nin): CirPatternReader(ifs, nin),
+      header_read(false), remaining(0), read_count(0) {}
+
+   int readBlock(gateval_t *vin);
+
+private:
+   bool header_read;
+   uint64_t remaining, read_count;
+
+   bool readHeader();
+};
+
+// writes the packed binary format. patterns are added one at a time or
+// a block at a time; sync() rewrites the header and the last partial
+// block in place, so the file is complete after every sync().
+class CirBinPatternWriter
+{
+public:
+   CirBinPatternWriter(): nin(0), count(0), npatt(0), block(NULL) {}
+   ~CirBinPatternWriter() { close(); }
+
+   bool open(const char *file, int nin);
+   bool isOpen() const { return block != NULL; }
+   void close();
+
+   // add the pattern held in bit b of every word
+   void addPattern(const gateval_t *vin, int b);
+   // add a block of n patterns laid out as in the file; only at a block
+   // boundary
+   void addBlock(const gateval_t *vin, int n);
+   void sync();
+
+   uint64_t getPatternCount() const { return npatt; }
+
+private:
+   ofstream ofs;
+   int nin, count;
+   uint64_t npatt;
+
+   // the block being filled, and where it goes in the file
+   gateval_t *block;
+   streampos block_pos;
+
+   void writeBlock();
+};
+
+// transpose a bits x bits matrix: bit j of a[i] goes to bit i of a[j]
+void transposeWords(gateval_t *a);
+
+// convert a text pattern file into the packed binary format
+bool packPatternFile(const char *textFile, const char *binFile);
+
+#endif // CIR_PATTERN_H
@@ -13,9 +13,10 @@
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
-#include <ctime>
+#include <algorithm>
 #include "cirMgr.h"
 #include "cirGate.h"
+#include "cirPattern.h"
 
 using namespace std;
 
@@ -24,6 +25,22 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// max number of patterns kept for distance-1 flipping
+#define SIM_KEEP_MAX 1024
+
+// circuits with at most this many PIs can be simulated exhaustively;
+// randomSim does so on its own up to SIM_AUTO_EXHAUSTIVE_PI
+#define SIM_EXHAUSTIVE_MAX_PI 24
+#define SIM_AUTO_EXHAUSTIVE_PI 16
+
+// rebuild the simulated cone when FEC members drop below this fraction
+// of those it was built for
+#define SIM_CONE_SHRINK 0.75
+
+// weight of the latest round in the refinement rate average
+#define SIM_RATE_ALPHA 0.3
+// rounds before the refinement rate is trusted
+#define SIM_WARMUP_ROUNDS 4
 
 /**************************************/
 /*   Static varaibles and functions   */
@@ -32,67 +49,209 @@ using namespace std;
 /************************************************/
 /*   Public member functions about Simulation   */
 /************************************************/
+void CirMgr::setSimPatternGen(SimPatternMode mode, int weight) {
+   if(sim_gen) {
+      delete sim_gen;
+      sim_gen = NULL;
+   }
+
+   switch(mode) {
+      case SIMGEN_BIASED:
+         sim_gen = new CirBiasedGen(sim_rng, weight);
+         break;
+      case SIMGEN_FLIP:
+         sim_gen = new CirFlipGen(sim_rng, sim_keep_patts);
+         break;
+      default:
+         break;
+   }
+}
+
+// cost of one equivalence query: the observed average once there are
+// enough SAT calls, otherwise a guess that grows with the circuit
+double CirMgr::estimateSatCostMs() const {
+   if(sat_calls >= 16)
+      return sat_time / sat_calls;
+   return 0.05 + nGates * 1e-4;
+}
+
+// number of gates still in some FEC group
+int CirMgr::countFecMembers() const {
+   int n = 0;
+   for(int i = 0, sz = fec_groups->size(); i < sz; ++i)
+      n += fec_groups->at(i)->size();
+   return n;
+}
+
+void CirMgr::keepSimulationPattern(const char *patt) {
+   if((int)sim_keep_patts.size() < SIM_KEEP_MAX) {
+      sim_keep_patts.push_back(patt);
+   } else {
+      sim_keep_patts[sim_keep_next] = patt;
+      sim_keep_next = (sim_keep_next + 1) % SIM_KEEP_MAX;
+   }
+}
+
 void
 CirMgr::randomSim()
 {
-   static int done_srand = 0;
-   if(!done_srand) {
-      srand(time(NULL));
-      done_srand = 1;
+   // plain random patterns on a small circuit: enumerating them all costs
+   // about the same and leaves nothing for SAT
+   if(!sim_no_fec && !sim_gen && sim_time_budget <= 0 &&
+         sim_patt_budget <= 0 && nInputs <= SIM_AUTO_EXHAUSTIVE_PI) {
+      exhaustiveSim();
+      return;
    }
 
+   CirPatternGen *gen = sim_gen ? sim_gen : &sim_rng;
+
    int per_batch = sizeof(gateval_t)*8;
 
-   gateval_t vin[nInputs];
-   char **pattern = new char *[per_batch];
-   char **result = new char *[per_batch];
+   gateval_t vin[nInputs], vout[nOutputs];
 
    memset(vin, 0, sizeof(gateval_t)*nInputs);
-   
-   for(int i = 0; i < per_batch; ++i) {
-      pattern[i] = new char[nInputs+1024];
-      result[i] = new char[nOutputs+1024];
+
+   if(_simLog)
+      sim_log = new CirSimLogWriter(*_simLog, nInputs, nOutputs,
+            sim_log_async);
+   gateval_t *out = sim_log ? vout : NULL;
+   if(sim_no_fec) buildSimCone(SIM_CONE_PO);
+   else buildSimCone(SIM_CONE_FEC | (out ? SIM_CONE_PO : 0));
+
+   // adaptive stop: one SAT call resolves about one candidate pair, so
+   // simulation is worth it while it splits more than that per SAT cost.
+   // LOW effort gives up earlier, HIGH/UNLIMITED keep simulating longer.
+   double threshold = 1.0 / estimateSatCostMs();
+   switch(sat_effort) {
+      case EFFORT_LOW: threshold *= 4; break;
+      case EFFORT_MED: break;
+      case EFFORT_HIGH: threshold /= 4; break;
+      default: threshold /= 16;
    }
 
-   int sim = 0, failed_count = 0;
+   double start = wallClockMs(), last = start, rate = 0.0;
+   int members = fec_groups ? countFecMembers() : nGates;
+   int sim = 0, rounds = 0;
+   const char *reason = "no FEC group left";
 
-   while(failed_count < surrender) {
+   while(sim_no_fec || !fec_groups || fec_groups->size() > 0) {
       sim++;
 
-      for(int i = 0; i < nInputs; ++i)
-         vin[i] = rand();
+      gen->generate(vin, nInputs);
 
-      for(int i = 0; i < nInputs; ++i) {
-         gateval_t v = vin[i];
-         for(int pid = per_batch-1; pid >= 0; --pid) {
-            pattern[pid][i] = (v & 1) ? '1' : '0';
-            v >>= 1;
-         }
+      int ret = -1;
+      if(sim_no_fec) evaluateSimCone(vin, out);
+      else ret = simulate(vin, out);
+
+      if(sim_log) sim_log->write(vin, vout, per_batch);
+
+      double now = wallClockMs();
+      if(sim_patt_budget > 0 && sim*per_batch >= sim_patt_budget) {
+         reason = "pattern budget reached";
+         break;
+      }
+      if(sim_time_budget > 0 && now - start >= sim_time_budget) {
+         reason = "time budget reached";
+         break;
       }
-      for(int i = 0; i < per_batch; ++i)
-         pattern[i][nInputs] = '\0';
 
-      if(simulate(vin, result) == 0)
-         failed_count++;
-      else
-         failed_count = 0;
+      // only refinement rounds (once every N words) update the rate
+      if(ret < 0) continue;
+
+      int now_members = countFecMembers();
+      double gain = ret + (members - now_members);
+      double elapsed = now - last;
+      if(elapsed < 1e-3) elapsed = 1e-3;
+
+      double r = gain / elapsed;
+      rate = rounds ? (SIM_RATE_ALPHA*r + (1-SIM_RATE_ALPHA)*rate) : r;
+      members = now_members;
+      last = now;
+
+      if(sim_patt_budget <= 0 && sim_time_budget <= 0 &&
+            ++rounds >= SIM_WARMUP_ROUNDS && rate < threshold) {
+         reason = "refinement rate too low";
+         break;
+      }
+   }
+   if(!sim_no_fec) refineFecGroups();
+   clearSimCone();
 
-      for(int i = 0; i < per_batch; ++i)
-         simulationResult(pattern[i], result[i]);
+   if(sim_log) {
+      delete sim_log;
+      sim_log = NULL;
    }
 
-   if(sim > 0 && fec_groups)
+   if(sim > 0 && fec_groups && !sim_no_fec)
       printf("#FEC groups: %d\n", (int)fec_groups->size());
-   printf("%d patterns simulated\n", sim*per_batch);
+   printf("%d patterns simulated (%s, %.1f ms)\n", sim*per_batch, reason,
+         wallClockMs() - start);
 
    if(is_debug) printFecGroups();
+}
 
-   for(int i = 0; i < per_batch; ++i) {
-      delete pattern[i];
-      delete result[i];
+// simulate all 2^nInputs patterns. the FEC groups left are then exact
+// equivalence classes, which fraig merges without SAT.
+bool CirMgr::exhaustiveSim() {
+   if(nInputs > SIM_EXHAUSTIVE_MAX_PI) {
+      fprintf(stderr, "Error: %d PIs, exhaustive simulation supports at "
+            "most %d!!\n", nInputs, SIM_EXHAUSTIVE_MAX_PI);
+      return false;
    }
-   delete[] pattern;
-   delete[] result;
+
+   int per_batch = sizeof(gateval_t)*8;
+   long long npatt = 1LL << nInputs;
+   long long nwords = (npatt + per_batch - 1) / per_batch;
+   // fewer PIs than bits per word repeat the same patterns in a word
+   int log_patt = (npatt < per_batch) ? (int)npatt : per_batch;
+
+   gateval_t vin[nInputs], vout[nOutputs];
+
+   if(_simLog)
+      sim_log = new CirSimLogWriter(*_simLog, nInputs, nOutputs,
+            sim_log_async);
+
+   // constants are found among all gates, not only FEC members
+   buildSimCone(SIM_CONE_ALL);
+
+   if(!sim_exact_seen) sim_exact_seen = new char[nMaxVar+1];
+   memset(sim_exact_seen, 0, sizeof(char)*(nMaxVar+1));
+
+   double start = wallClockMs();
+
+   for(long long w = 0; w < nwords; ++w) {
+      for(int i = 0; i < nInputs; ++i)
+         vin[i] = enumerationWord(i, w);
+
+      simulate(vin, sim_log ? vout : NULL);
+
+      if(sim_log) sim_log->write(vin, vout, log_patt);
+
+      // a scoped cone leaves the vars outside it unevaluated: they stay
+      // unknown (0) rather than "only ever 0"
+      for(int i = 0; i <= nMaxVar; ++i) {
+         if(vars[i]->isRemoved() || (fec_scope && !fec_scope[i])) continue;
+         gateval_t v = sim_cone_val[i];
+         if(v != 0) sim_exact_seen[i] |= 2;
+         if(~v != 0) sim_exact_seen[i] |= 1;
+      }
+   }
+   refineFecGroups();
+   clearSimCone();
+   fec_exact = true;
+
+   if(sim_log) {
+      delete sim_log;
+      sim_log = NULL;
+   }
+
+   printf("#FEC groups: %d\n", (int)fec_groups->size());
+   printf("%lld patterns simulated (exhaustive, %.1f ms)\n", npatt,
+         wallClockMs() - start);
+
+   if(is_debug) printFecGroups();
+
+   return true;
 }
 
 bool CirMgr::simuationError(const char *msgfmt, ...) {
@@ -100,131 +259,411 @@ bool CirMgr::simuationError(const char *msgfmt, ...) {
    va_start(args, msgfmt);
    if(_simLog) {
       char buf[1024];
-      vsprintf(buf, msgfmt, args);
-      *_simLog << buf;
+      vsnprintf(buf, sizeof(buf), msgfmt, args);
+      if(sim_log) sim_log->puts(buf);
+      else *_simLog << buf;
    } else
       vfprintf(stderr, msgfmt, args);
    va_end(args);
    return false;
 }
 
-void CirMgr::simulationResult(const char *patt, const char *result) {
-   if(_simLog) {
-      *_simLog << patt << " " << result << endl;
-   } else {
-      //printf("%s %s\n", patt, result);
-   }
-}
-
 void CirMgr::fileSim(ifstream &ifs) {
    int per_batch = sizeof(gateval_t)*8;
 
-   char buf[nInputs+1024];
-   gateval_t vin[nInputs];
+   gateval_t vin[nInputs], vout[nOutputs];
    char **pattern = new char *[per_batch];
-   char **result = new char *[per_batch];
 
    memset(vin, 0, sizeof(gateval_t)*nInputs);
-   
-   for(int i = 0; i < per_batch; ++i) {
-      pattern[i] = new char[nInputs+1024];
-      result[i] = new char[nOutputs+1024];
-   }
 
-   int sim = 0, in_queue = 0;
-
-   ifs.getline(buf, nInputs+1024);
-   while(!ifs.eof()) {
-      sim++;
-      if(!checkSimulationPattern(buf)) {
-         simuationError("Simulation error on line %d\n", sim);
-         simuationError("Simulation terminated\n");
-         break;
+   for(int i = 0; i < per_batch; ++i)
+      pattern[i] = new char[nInputs+1];
+
+   if(_simLog)
+      sim_log = new CirSimLogWriter(*_simLog, nInputs, nOutputs,
+            sim_log_async);
+   gateval_t *out = sim_log ? vout : NULL;
+   if(sim_no_fec) buildSimCone(SIM_CONE_PO);
+   else buildSimCone(SIM_CONE_FEC | (out ? SIM_CONE_PO : 0));
+
+   // both readers hand out word-transposed blocks ready for simulate()
+   CirPatternReader *rd;
+   if(CirPatternReader::isBinaryFile(ifs))
+      rd = new CirBinPatternReader(ifs, nInputs);
+   else
+      rd = new CirTextPatternReader(ifs, nInputs);
+
+   // the flip bases are the last SIM_KEEP_MAX patterns: the blocks that
+   // may hold them are copied aside and unpacked once the file is read
+   int tail_max = SIM_KEEP_MAX/per_batch + 1, tail_next = 0, tail_cnt = 0;
+   gateval_t *tail = new gateval_t[tail_max*nInputs];
+   int *tail_n = new int[tail_max];
+
+   int sim = 0, n;
+
+   while((n = rd->readBlock(vin)) > 0) {
+      sim += n;
+
+      if(sim_no_fec) {
+         evaluateSimCone(vin, out);
+         if(sim_log) sim_log->write(vin, vout, n);
+         continue;
       }
 
-      pushSimulationPattern(buf, vin);
-      strcpy(pattern[in_queue], buf);
-
-      if(++in_queue >= per_batch) {
-         in_queue = 0;
+      simulate(vin, out);
 
-         simulate(vin, result);
+      if(sim_log) sim_log->write(vin, vout, n);
 
-         for(int i = 0; i < per_batch; ++i)
-            simulationResult(pattern[i], result[i]);
-      }
+      memcpy(tail + tail_next*nInputs, vin, sizeof(gateval_t)*nInputs);
+      tail_n[tail_next] = n;
+      tail_next = (tail_next + 1) % tail_max;
+      if(tail_cnt < tail_max) tail_cnt++;
+   }
 
-      ifs.getline(buf, nInputs+1024);
+   // pattern strings are only needed for the flip bases
+   int skip = -SIM_KEEP_MAX;
+   for(int b = 0; b < tail_cnt; ++b)
+      skip += tail_n[b];
+   for(int b = 0; b < tail_cnt; ++b) {
+      int t = (tail_next - tail_cnt + b + tail_max) % tail_max;
+      unpackSimulationPatterns(tail + t*nInputs, pattern);
+      for(int i = 0; i < tail_n[t]; ++i, --skip)
+         if(skip <= 0) keepSimulationPattern(pattern[i]);
    }
+   delete[] tail;
+   delete[] tail_n;
 
-   if(in_queue > 0) {
-      simulate(vin, result);
+   if(!sim_no_fec) refineFecGroups();
+   clearSimCone();
 
-      for(int i = 0; i < in_queue; ++i)
-         simulationResult(pattern[i], result[per_batch-in_queue+i]);
+   if(rd->failed()) {
+      simuationError("%s\n", rd->getErrorMsg().c_str());
+      simuationError("Simulation error on %s\n", rd->getErrorPos().c_str());
+      simuationError("Simulation terminated\n");
+   }
+   delete rd;
 
-      in_queue = 0;
+   if(sim_log) {
+      delete sim_log;
+      sim_log = NULL;
    }
 
-   if(sim > 0 && fec_groups)
+   if(sim > 0 && fec_groups && !sim_no_fec)
       printf("#FEC groups: %d\n", (int)fec_groups->size());
    printf("%d pattern(s) simulated\n", sim);
 
    if(is_debug) printFecGroups();
 
-   for(int i = 0; i < per_batch; ++i) {
-      delete pattern[i];
-      delete result[i];
-   }
+   for(int i = 0; i < per_batch; ++i)
+      delete[] pattern[i];
    delete[] pattern;
-   delete[] result;
 }
 
-bool CirMgr::checkSimulationPattern(const char *patt) {
-   int len = strlen(patt);
+// pattern[pid] takes bit (per_batch-1-pid) of every input word
+void CirMgr::unpackSimulationPatterns(const gateval_t *vin, char **pattern) {
+   int per_batch = sizeof(gateval_t)*8;
 
-   if(len != nInputs)
-      return simuationError("pattern length not equal to input length\n");
+   for(int i = 0; i < nInputs; ++i) {
+      gateval_t v = vin[i];
+      for(int pid = per_batch-1; pid >= 0; --pid) {
+         pattern[pid][i] = (v & 1) ? '1' : '0';
+         v >>= 1;
+      }
+   }
+   for(int i = 0; i < per_batch; ++i)
+      pattern[i][nInputs] = '\0';
+}
 
-   for(int i = 0; i < len; ++i)
-      if(patt[i] != '0' && patt[i] != '1')
-         return simuationError("pattern should contains 0/1 only\n");
+// evaluate one word over the current cone (built for FEC members, plus
+// PO cones when vout is wanted) and record it into the signatures of
+// the PIs and cone gates. gates outside the cone keep stale signatures,
+// they are in no FEC group.
+void CirMgr::simulateWord(gateval_t *vin, gateval_t *vout) {
+   if(!sim_cone_val)
+      buildSimCone(SIM_CONE_FEC | (vout ? SIM_CONE_PO : 0));
+
+   evaluateSimCone(vin, vout);
+
+   // record this word into the signatures
+   if(!sim_sig) {
+      sim_sig = new gateval_t[(nMaxVar+1)*sim_sig_words];
+      memset(sim_sig, 0, sizeof(gateval_t)*(nMaxVar+1)*sim_sig_words);
+      sim_sig_pos = sim_sig_filled = 0;
+   }
+   for(int i = 0; i < nInputs; ++i)
+      sim_sig[inputs[i]->getVarId()*sim_sig_words+sim_sig_pos] = vin[i];
+   for(int i = 0, n = sim_cone.size(); i < n; ++i)
+      sim_sig[sim_cone[i]*sim_sig_words+sim_sig_pos] =
+         sim_cone_val[sim_cone[i]];
 
-   return true;
+   if(++sim_sig_pos > sim_sig_filled)
+      sim_sig_filled = sim_sig_pos;
 }
 
-void CirMgr::pushSimulationPattern(const char *patt, gateval_t *vin) {
-   for(int i = 0; i < nInputs; ++i)
-      vin[i] = (vin[i] << 1)|(patt[i] == '1'?1:0);
+// simulate one word; refine FEC groups when the signatures are full.
+// return -1 if refinement is deferred, otherwise the #groups gained.
+int CirMgr::simulate(gateval_t *vin, gateval_t *vout) {
+   simulateWord(vin, vout);
+
+   if(sim_sig_pos < sim_sig_words)
+      return -1;
+
+   return refineFecGroups();
+}
+
+// collect the AIG gates in the fanin cones of the given roots, fanins
+// first. SIM_CONE_FEC means every gate before the first refinement.
+void CirMgr::buildSimCone(int roots) {
+   bool visited[nMaxVar+1];
+   memset(visited, 0, sizeof(bool)*(nMaxVar+1));
+
+   sim_cone.clear();
+   sim_cone_roots = roots;
+   sim_cone_members = 0;
+
+   if((roots & SIM_CONE_ALL) || ((roots & SIM_CONE_FEC) && !fec_groups)) {
+      for(int i = 0; i < nGates; ++i)
+         if(!gates[i]->isRemoved() &&
+               (!fec_scope || fec_scope[gates[i]->getVarId()]))
+            buildSimConeDFS(visited, gates[i]->getVarId());
+      sim_cone_members = nGates;
+   } else if(roots & SIM_CONE_FEC) {
+      for(int i = 0, n = fec_groups->size(); i < n; ++i) {
+         const vector<int> *s = fec_groups->at(i);
+         for(int j = 0, sz = s->size(); j < sz; ++j)
+            if(!vars[s->at(j)>>1]->isRemoved())
+               buildSimConeDFS(visited, s->at(j)>>1);
+         sim_cone_members += s->size();
+      }
+   }
+   if(roots & SIM_CONE_PO) {
+      for(int i = 0; i < nOutputs; ++i)
+         buildSimConeDFS(visited, outputs[i]->getIN0() >> 1);
+   }
+
+   if(!sim_cone_val) {
+      sim_cone_val = new gateval_t[nMaxVar+1];
+      memset(sim_cone_val, 0, sizeof(gateval_t)*(nMaxVar+1));
+   }
 }
 
-int CirMgr::simulate(gateval_t *vin, char **result) {
-   for(int i = 1; i <= nMaxVar; ++i) vars[i]->resetState();
-   for(int i = 0; i < nOutputs; ++i) outputs[i]->resetState();
+void CirMgr::buildSimConeDFS(bool *visited, int varid) {
+   if(visited[varid]) return;
+   visited[varid] = true;
+
+   CirVar *v = vars[varid];
+   if(v->getType() != AIG_GATE) return;
+
+   buildSimConeDFS(visited, v->getIN0() >> 1);
+   buildSimConeDFS(visited, v->getIN1() >> 1);
+   sim_cone.push_back(varid);
+}
+
+// the cone is only valid while the circuit is unchanged
+void CirMgr::clearSimCone() {
+   sim_cone.clear();
+   if(sim_cone_val) delete[] sim_cone_val;
+   sim_cone_val = NULL;
+}
+
+// evaluate one word over the cone only, and the PO responses if vout;
+// gates outside it, signatures and FEC groups are left untouched
+void CirMgr::evaluateSimCone(const gateval_t *vin, gateval_t *vout) {
+   gateval_t *val = sim_cone_val;
 
    for(int i = 0; i < nInputs; ++i)
-      inputs[i]->setVal(vin[i]);
+      val[inputs[i]->getVarId()] = vin[i];
+
+   for(int i = 0, n = sim_cone.size(); i < n; ++i) {
+      const CirVar *v = vars[sim_cone[i]];
+      int in0 = v->getIN0(), in1 = v->getIN1();
+      val[sim_cone[i]] = (val[in0>>1] ^ -(gateval_t)(in0&1)) &
+                         (val[in1>>1] ^ -(gateval_t)(in1&1));
+   }
 
-   int n_patt = sizeof(gateval_t)*8;
+   if(!vout) return;
    for(int i = 0; i < nOutputs; ++i) {
-      gateval_t v = outputs[i]->evaluate();
+      int in0 = outputs[i]->getIN0();
+      vout[i] = val[in0>>1] ^ -(gateval_t)(in0&1);
+   }
+}
 
-      if(result) {
-         for(int pid = n_patt-1; pid >= 0; --pid) {
-            result[pid][i] = (v & 1) ? '1' : '0';
-            v >>= 1;
+bool CirMgr::setSimCorpus(const string &file) {
+   if(sim_corpus) {
+      printf("%llu distinguishing pattern(s) saved\n",
+            (unsigned long long)sim_corpus->getPatternCount());
+      delete sim_corpus;
+      sim_corpus = NULL;
+   }
+   if(file.empty()) return true;
+
+   sim_corpus = new CirBinPatternWriter();
+   if(!sim_corpus->open(file.c_str(), nInputs)) {
+      delete sim_corpus;
+      sim_corpus = NULL;
+      return false;
+   }
+   return true;
+}
+
+// conts are the pieces one group splits into, phases relative to their
+// window signatures. mark in useful enough bits that no two pieces are
+// equal or complementary on the marked bits, so they stay apart whatever
+// phase a replay first sees them in. pieces are bucketed by their values
+// on the bits marked so far, each taken in the phase that has the lowest
+// marked bit 0. a bucket still holding several is split on one bit where
+// the first two differ once lined up in phase, marked if it is not yet,
+// until every bucket holds one piece.
+void CirMgr::markSplittingPatterns(const vector<vector<int> *> &conts,
+      int nwords, gateval_t *useful) const {
+   int k = conts.size();
+   if(k < 2) return;
+
+   vector<const gateval_t *> sig(k);
+   vector<gateval_t> mask(k);
+   for(int c = 0; c < k; ++c) {
+      int lit = conts[c]->at(0);
+      sig[c] = &sim_sig[(lit>>1)*sim_sig_words];
+      mask[c] = (lit&1) ? ~(gateval_t)0 : 0;
+   }
+
+   // nothing marked yet: a bit where the first two differ and one where
+   // they agree, so the phase below is defined
+   int w0 = 0;
+   while(w0 < nwords && !useful[w0]) ++w0;
+   if(w0 == nwords) {
+      gateval_t diff = 0, agree = 0;
+      for(int w = 0; w < nwords; ++w) {
+         gateval_t x = (sig[0][w] ^ mask[0]) ^ (sig[1][w] ^ mask[1]);
+         if(!diff && x) useful[w] |= (diff = x & -x);
+         if(!agree && ~x) useful[w] |= (agree = ~x & -~x);
+      }
+      w0 = 0;
+      while(w0 < nwords && !useful[w0]) ++w0;
+      assert(w0 < nwords);
+   }
+   gateval_t b0 = useful[w0] & -useful[w0];
+
+   // each piece in the phase with the lowest marked bit 0: pieces equal
+   // or complementary on the marked bits get equal values
+   vector<pair<uint64_t, int> > key(k);
+   for(int c = 0; c < k; ++c) {
+      mask[c] ^= ((sig[c][w0] ^ mask[c]) & b0) ? ~(gateval_t)0 : 0;
+
+      uint64_t h = 14695981039346656037ULL;
+      for(int w = 0; w < nwords; ++w)
+         h = (h ^ ((sig[c][w] ^ mask[c]) & useful[w])) * 1099511628211ULL;
+      key[c] = make_pair(h, c);
+   }
+   sort(key.begin(), key.end());
+
+   // [begin, end) ranges of idx still to be split
+   vector<int> idx(k);
+   vector<pair<int, int> > todo;
+   for(int i = 0, b = 0; i < k; ++i) {
+      idx[i] = key[i].second;
+      if(i+1 == k || key[i+1].first != key[i].first) {
+         if(i > b) todo.push_back(make_pair(b, i+1));
+         b = i+1;
+      }
+   }
+
+   while(!todo.empty()) {
+      int b = todo.back().first, e = todo.back().second;
+      todo.pop_back();
+
+      // a marked bit if only the hash put the first two together, else
+      // the lowest bit where they differ. pieces complementary over the
+      // whole window cannot be kept apart: split them on any bit.
+      int p = idx[b], q = idx[b+1], sw = -1;
+      gateval_t bit = 0, flip = 0;
+      for(int pass = 0; pass < 3 && !bit; ++pass) {
+         if(pass == 2) flip = ~(gateval_t)0;
+         for(int w = 0; w < nwords && !bit; ++w) {
+            gateval_t x = (sig[p][w] ^ mask[p]) ^ (sig[q][w] ^ mask[q]) ^
+                          flip;
+            if(!pass) x &= useful[w];
+            if(!x) continue;
+            bit = x & -x;
+            sw = w;
+            useful[w] |= bit;
          }
       }
+      // pieces differ somewhere in the window
+      assert(bit);
+
+      gateval_t pv = (sig[p][sw] ^ mask[p]) & bit;
+      int m = b;
+      for(int i = b; i < e; ++i) {
+         int c = idx[i];
+         gateval_t cv = sig[c][sw] ^ mask[c];
+         if(flip && c != p) cv = ~cv;
+         if((cv & bit) == pv)
+            swap(idx[i], idx[m++]);
+      }
+      if(m - b > 1) todo.push_back(make_pair(b, m));
+      if(e - m > 1) todo.push_back(make_pair(m, e));
    }
-   if(result) {
-      for(int pid = n_patt-1; pid >= 0; --pid)
-         result[pid][nOutputs] = '\0';
+}
+
+void CirMgr::saveSplittingPatterns(const gateval_t *useful, int nwords) {
+   const int per_word = sizeof(gateval_t)*8;
+   gateval_t vin[nInputs];
+   bool saved = false;
+
+   for(int w = 0; w < nwords; ++w) {
+      if(!useful[w]) continue;
+
+      for(int i = 0; i < nInputs; ++i)
+         vin[i] = sim_sig[inputs[i]->getVarId()*sim_sig_words+w];
+      for(int b = 0; b < per_word; ++b)
+         if((useful[w] >> b) & 1)
+            sim_corpus->addPattern(vin, b);
+      saved = true;
    }
+   if(saved) sim_corpus->sync();
+}
+
+// refine FEC groups with the words simulated since last refinement
+int CirMgr::refineFecGroups() {
+   if(sim_sig_pos == 0) return 0;
 
    int ret = FecGrouping();
+   sim_sig_pos = 0;
+
+   // shrink the cone once enough members have left their groups
+   if(sim_cone_val && (sim_cone_roots & SIM_CONE_FEC) &&
+         countFecMembers() < sim_cone_members * SIM_CONE_SHRINK)
+      buildSimCone(sim_cone_roots);
+
    printf("#FEC groups: %d\r", (int)fec_groups->size());
    fflush(stdout);
 
    return ret;
 }
 
+void CirMgr::setSimSignatureWords(int n) {
+   if(n < 1) n = 1;
+
+   refineFecGroups();
+
+   if(n != sim_sig_words) {
+      if(sim_sig) delete[] sim_sig;
+      sim_sig = NULL;
+      sim_sig_words = n;
+      sim_sig_pos = sim_sig_filled = 0;
+   }
+}
+
+// true if v0 and (v1 ^ inv_flag) agree on every simulated word
+bool CirMgr::simSignatureMatch(int v0, int v1, bool inv_flag) const {
+   if(!sim_sig) return true;
+
+   const gateval_t *s0 = &sim_sig[v0*sim_sig_words];
+   const gateval_t *s1 = &sim_sig[v1*sim_sig_words];
+   gateval_t mask = inv_flag ? ~(gateval_t)0 : 0;
+
+   for(int i = 0; i < sim_sig_filled; ++i)
+      if(s0[i] != (s1[i] ^ mask)) return false;
+   return true;
+}
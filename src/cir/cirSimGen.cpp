@@ -0,0 +1,121 @@
+/****************************************************************************
+  FileName     [ cirSimGen.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern generators ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cassert>
+#include "cirSimGen.h"
+
+using namespace std;
+
+/*******************************/
+/*   class CirRandomGen        */
+/*******************************/
+static inline uint64_t rotl(uint64_t x, int k) {
+   return (x << k) | (x >> (64 - k));
+}
+
+void CirRandomGen::setSeed(uint64_t seed) {
+   // SplitMix64 expands the seed into the xoshiro state
+   for(int i = 0; i < 4; ++i) {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      s[i] = z ^ (z >> 31);
+   }
+   buf = 0;
+   buf_bits = 0;
+}
+
+uint64_t CirRandomGen::next64() {
+   uint64_t result = rotl(s[1] * 5, 7) * 9;
+   uint64_t t = s[1] << 17;
+
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = rotl(s[3], 45);
+
+   return result;
+}
+
+gateval_t CirRandomGen::nextWord() {
+   const int bits = sizeof(gateval_t)*8;
+   if(bits >= 64) return (gateval_t)next64();
+
+   // hand out a 64-bit output in gateval_t sized pieces
+   if(buf_bits < bits) {
+      buf = next64();
+      buf_bits = 64;
+   }
+   gateval_t v = (gateval_t)buf;
+   buf >>= bits;
+   buf_bits -= bits;
+   return v;
+}
+
+/*******************************/
+/*   class CirBiasedGen        */
+/*******************************/
+gateval_t CirBiasedGen::biasedWord(int w) {
+   if(w <= 0) return 0;
+   if(w >= 256) return ~(gateval_t)0;
+
+   // walk the binary expansion of w/256 from its lowest set bit:
+   // OR with a fair word for a 1, AND for a 0
+   int i = 0;
+   while(!((w >> i) & 1)) ++i;
+
+   gateval_t x = rng.nextWord();
+   for(++i; i < 8; ++i) {
+      if((w >> i) & 1) x |= rng.nextWord();
+      else x &= rng.nextWord();
+   }
+   return x;
+}
+
+void CirBiasedGen::generate(gateval_t *vin, int nin) {
+   for(int i = 0; i < nin; ++i) {
+      int w = weight;
+      if(i < (int)pi_weight.size() && pi_weight[i] >= 0)
+         w = pi_weight[i];
+      vin[i] = biasedWord(w);
+   }
+}
+
+/*******************************/
+/*   class CirFlipGen          */
+/*******************************/
+void CirFlipGen::generate(gateval_t *vin, int nin) {
+   if(pool.empty() || nin == 0) {
+      rng.generate(vin, nin);
+      return;
+   }
+
+   if(base >= (int)pool.size()) base = 0;
+   const string &patt = pool[base];
+   assert((int)patt.size() == nin);
+
+   const int per_word = sizeof(gateval_t)*8;
+
+   for(int i = 0; i < nin; ++i)
+      vin[i] = (patt[i] == '1') ? ~(gateval_t)0 : 0;
+
+   // slot 0 keeps the stored pattern, slot k flips PI (cursor+k-1)
+   for(int k = 1; k < per_word; ++k) {
+      int pi = cursor + k - 1;
+      if(pi >= nin) break;
+      vin[pi] ^= ((gateval_t)1 << k);
+   }
+
+   cursor += per_word - 1;
+   if(cursor >= nin) {
+      cursor = 0;
+      base++;
+   }
+}
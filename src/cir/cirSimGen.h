@@ -0,0 +1,116 @@
+/****************************************************************************
+  FileName     [ cirSimGen.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define simulation pattern generators ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_SIM_GEN_H
+#define CIR_SIM_GEN_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+#include "cirGate.h"
+
+using namespace std;
+
+enum SimPatternMode {
+   SIMGEN_RANDOM,
+   SIMGEN_BIASED,
+   SIMGEN_FLIP
+};
+
+// generator interface used by randomSim: fill one word per PI
+class CirPatternGen
+{
+public:
+   virtual ~CirPatternGen() {}
+
+   virtual void generate(gateval_t *vin, int nin) = 0;
+};
+
+// xoshiro256** seeded by SplitMix64; all bits of every word are random
+class CirRandomGen: public CirPatternGen
+{
+public:
+   CirRandomGen(uint64_t seed = 0) { setSeed(seed); }
+
+   void setSeed(uint64_t seed);
+
+   uint64_t next64();
+   gateval_t nextWord();
+
+   void generate(gateval_t *vin, int nin) {
+      for(int i = 0; i < nin; ++i)
+         vin[i] = nextWord();
+   }
+
+private:
+   uint64_t s[4];
+   uint64_t buf;
+   int buf_bits;
+};
+
+// each PI bit is 1 with probability weight/256, composed from fair words
+class CirBiasedGen: public CirPatternGen
+{
+public:
+   CirBiasedGen(CirRandomGen &rng, int weight): rng(rng) {
+      setWeight(weight);
+   }
+
+   // weight in 1/256, applies to PIs without their own weight
+   void setWeight(int w) { weight = clampWeight(w); }
+   void setWeight(int pi, int w) {
+      if(pi >= (int)pi_weight.size()) pi_weight.resize(pi+1, -1);
+      pi_weight[pi] = clampWeight(w);
+   }
+
+   void generate(gateval_t *vin, int nin);
+
+private:
+   CirRandomGen &rng;
+   int weight;
+   vector<int> pi_weight;
+
+   static int clampWeight(int w) { return w < 0 ? 0 : (w > 256 ? 256 : w); }
+   gateval_t biasedWord(int w);
+};
+
+// distance-1 neighbors of stored patterns: slot 0 of a word carries the
+// stored pattern itself, every other slot flips one PI of it. successive
+// words walk through all PIs before moving to the next stored pattern.
+class CirFlipGen: public CirPatternGen
+{
+public:
+   CirFlipGen(CirRandomGen &rng, const vector<string> &pool):
+      rng(rng), pool(pool), base(0), cursor(0) {}
+
+   void generate(gateval_t *vin, int nin);
+
+private:
+   CirRandomGen &rng;
+   const vector<string> &pool;
+   int base, cursor;
+};
+
+// word w of the exhaustive enumeration for input j: over all words, bit b
+// of word w carries bit j of (w*bits + b)
+inline gateval_t enumerationWord(int j, long long w) {
+   const int W = sizeof(gateval_t)*8;
+   int lw = 0;
+   while((1 << lw) < W) ++lw;
+
+   if(j >= lw)
+      return ((w >> (j-lw)) & 1) ? ~(gateval_t)0 : 0;
+
+   gateval_t m = 0;
+   for(int b = 0; b < W; ++b)
+      if((b >> j) & 1) m |= (gateval_t)1 << b;
+   return m;
+}
+
+#endif // CIR_SIM_GEN_H
@@ -0,0 +1,197 @@
+/****************************************************************************
+  FileName     [ cirSimLog.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define buffered simulation log writer ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cstring>
+#include <cassert>
+#include "cirSimLog.h"
+#include "cirPattern.h"
+
+using namespace std;
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static const int W = sizeof(gateval_t)*8;
+
+// size of each log buffer
+#define LOG_BUF_SIZE (1<<22)
+
+// expand[b] holds the 8 chars '0'/'1' of bits 0..7 of b, in memory order
+static uint64_t expand[256];
+static bool expand_ready = false;
+
+static void initExpand() {
+   if(expand_ready) return;
+   for(int b = 0; b < 256; ++b) {
+      char c[8];
+      for(int j = 0; j < 8; ++j)
+         c[j] = ((b >> j) & 1) ? '1' : '0';
+      memcpy(&expand[b], c, 8);
+   }
+   expand_ready = true;
+}
+
+/***************************************/
+/*   class CirSimLogWriter             */
+/***************************************/
+CirSimLogWriter::CirSimLogWriter(ostream &os, int nin, int nout,
+      bool threaded): os(os), nin(nin), nout(nout), threaded(threaded) {
+   initExpand();
+
+   line_len = nin + 1 + nout + 1;
+   buf_size = LOG_BUF_SIZE;
+   if(buf_size < W*line_len) buf_size = W*line_len;
+   buf[0] = new char[buf_size];
+   buf[1] = threaded ? new char[buf_size] : NULL;
+   cur = pos = 0;
+
+   stop = false;
+   pending = -1;
+   pending_len = 0;
+   if(threaded) {
+      pthread_mutex_init(&mutex, NULL);
+      pthread_cond_init(&cond, NULL);
+      if(pthread_create(&thread, NULL, threadMain, this) != 0) {
+         // no thread, write synchronously
+         pthread_mutex_destroy(&mutex);
+         pthread_cond_destroy(&cond);
+         this->threaded = false;
+      }
+   }
+}
+
+CirSimLogWriter::~CirSimLogWriter() {
+   flush();
+
+   if(threaded) {
+      pthread_mutex_lock(&mutex);
+      stop = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      pthread_join(thread, NULL);
+      pthread_mutex_destroy(&mutex);
+      pthread_cond_destroy(&cond);
+   }
+
+   delete[] buf[0];
+   if(buf[1]) delete[] buf[1];
+}
+
+void *CirSimLogWriter::threadMain(void *arg) {
+   CirSimLogWriter *w = (CirSimLogWriter *)arg;
+
+   pthread_mutex_lock(&w->mutex);
+   for(;;) {
+      while(w->pending < 0 && !w->stop)
+         pthread_cond_wait(&w->cond, &w->mutex);
+      if(w->pending < 0) break;
+
+      const char *p = w->buf[w->pending];
+      int len = w->pending_len;
+      pthread_mutex_unlock(&w->mutex);
+
+      w->os.write(p, len);
+
+      pthread_mutex_lock(&w->mutex);
+      w->pending = -1;
+      pthread_cond_broadcast(&w->cond);
+   }
+   pthread_mutex_unlock(&w->mutex);
+   return NULL;
+}
+
+void CirSimLogWriter::waitPending() {
+   pthread_mutex_lock(&mutex);
+   while(pending >= 0)
+      pthread_cond_wait(&cond, &mutex);
+   pthread_mutex_unlock(&mutex);
+}
+
+// hand the current buffer to the writer (or write it) and start over
+void CirSimLogWriter::swapBuffer() {
+   if(pos == 0) return;
+
+   if(threaded) {
+      waitPending();
+      pthread_mutex_lock(&mutex);
+      pending = cur;
+      pending_len = pos;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      cur ^= 1;
+   } else
+      os.write(buf[cur], pos);
+   pos = 0;
+}
+
+void CirSimLogWriter::reserve(int len) {
+   assert(len <= buf_size);
+   if(pos + len > buf_size)
+      swapBuffer();
+}
+
+void CirSimLogWriter::flush() {
+   swapBuffer();
+   if(threaded) waitPending();
+   os.flush();
+}
+
+void CirSimLogWriter::puts(const char *s) {
+   int len = strlen(s);
+   if(len > buf_size) {
+      flush();
+      os.write(s, len);
+      return;
+   }
+   reserve(len);
+   memcpy(&buf[cur][pos], s, len);
+   pos += len;
+}
+
+// write chars col..col+n-1 of the first npatt lines from n words
+void CirSimLogWriter::putRows(const gateval_t *v, int n, int col, int npatt) {
+   gateval_t a[W];
+   char *line0 = &buf[cur][pos + col];
+
+   for(int base = 0; base < n; base += W) {
+      int cnt = n - base;
+      if(cnt > W) cnt = W;
+
+      for(int i = 0; i < W; ++i)
+         a[i] = (i < cnt) ? v[base+i] : 0;
+      transposeWords(a);
+
+      // bit i of a[W-1-k] is word (base+i) of pattern k
+      for(int k = 0; k < npatt; ++k) {
+         gateval_t r = a[W-1-k];
+         char *p = line0 + k*line_len + base;
+         int b = 0;
+         for(; b + 8 <= cnt; b += 8, r >>= 8)
+            memcpy(&p[b], &expand[r & 0xff], 8);
+         for(; b < cnt; ++b, r >>= 1)
+            p[b] = (r & 1) ? '1' : '0';
+      }
+   }
+}
+
+void CirSimLogWriter::write(const gateval_t *vin, const gateval_t *vout,
+      int npatt) {
+   if(npatt <= 0) return;
+
+   reserve(npatt*line_len);
+
+   putRows(vin, nin, 0, npatt);
+   putRows(vout, nout, nin + 1, npatt);
+
+   char *p = &buf[cur][pos];
+   for(int k = 0; k < npatt; ++k, p += line_len) {
+      p[nin] = ' ';
+      p[line_len-1] = '\n';
+   }
+   pos += npatt*line_len;
+}
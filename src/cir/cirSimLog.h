@@ -0,0 +1,61 @@
+/****************************************************************************
+  FileName     [ cirSimLog.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define buffered simulation log writer ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-2010 LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_SIM_LOG_H
+#define CIR_SIM_LOG_H
+
+#include <ostream>
+#include <pthread.h>
+
+#include "cirGate.h"
+
+using namespace std;
+
+// Writes "<PI values> <PO values>" lines straight from simulation words.
+// Words are bit-matrix transposed into rows and expanded 8 bits at a time
+// into a large buffer, which is written out in one block when full. With
+// a background thread, a full buffer is handed to the thread and filling
+// continues in a second buffer.
+class CirSimLogWriter
+{
+public:
+   CirSimLogWriter(ostream &os, int nin, int nout, bool threaded = false);
+   ~CirSimLogWriter();
+
+   // log the first npatt patterns of a word block (pattern k is bit
+   // (bits-1-k) of every word, as in simulate())
+   void write(const gateval_t *vin, const gateval_t *vout, int npatt);
+   // plain text, kept in order with the pattern lines
+   void puts(const char *s);
+   // write out everything buffered so far
+   void flush();
+
+private:
+   ostream &os;
+   int nin, nout, line_len;
+
+   char *buf[2];
+   int buf_size, cur, pos;
+
+   // background writer: pending is the buffer index handed over (-1 if
+   // none), pending_len its length
+   bool threaded, stop;
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   int pending, pending_len;
+
+   void reserve(int len);
+   void swapBuffer();
+   void waitPending();
+   void putRows(const gateval_t *v, int n, int col, int npatt);
+
+   static void *threadMain(void *arg);
+};
+
+#endif // CIR_SIM_LOG_H
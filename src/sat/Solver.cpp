@@ -20,6 +20,7 @@ OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWA
 #include "Solver.h"
 #include "Sort.h"
 #include <cmath>
+#include <sys/time.h>
 
 
 //=================================================================================================
@@ -183,6 +184,11 @@ bool Solver::simplify(Clause* c) const
 //
 Var Solver::newVar() {
     int     index;
+    if (free_vars.size() > 0){
+        index = free_vars.last(); free_vars.pop();
+        decision[index] = 1;
+        order.undo(index);
+        return index; }
     index = nVars();
     watches     .push();          // (list for positive literal)
     watches     .push();          // (list for negative literal)
@@ -191,12 +197,22 @@ Var Solver::newVar() {
     level       .push(-1);
     trail_pos   .push(-1);
     activity    .push(0);
+    decision    .push(1);
     order       .newVar();
     analyze_seen.push(0);
     if (proof != NULL) unit_id.push(ClauseId_NULL);
     return index; }
 
 
+// The var of 'l' must only occur in clauses that 'l' satisfies (e.g. an activation literal that
+// was only ever assumed as '~l'). Once those are removed it is unassigned and handed out again.
+//
+void Solver::releaseVar(Lit l) {
+    if (value(l) == l_False) return;
+    if (value(l) == l_Undef) addUnit(l);
+    released_vars.push(var(l)); }
+
+
 // Returns FALSE if immediate conflict.
 bool Solver::assume(Lit p) {
     trail_lim.push(trail.size());
@@ -625,6 +641,31 @@ void Solver::simplifyDB()
         cs.shrink(cs.size()-j);
     }
 
+    // Free released vars: their clauses are gone, take them off the top-level trail:
+    if (released_vars.size() > 0 && proof == NULL){
+        int n = 0;
+        for (int i = 0; i < released_vars.size(); i++){
+            Var x = released_vars[i];
+            if (reason[x] == NULL) analyze_seen[x] = 1, n++; }    // (a clause implying it is still locked)
+        if (n > 0){
+            int j = 0;
+            for (int i = 0; i < trail.size(); i++){
+                Var x = var(trail[i]);
+                if (analyze_seen[x]){
+                    analyze_seen[x] = 0;
+                    assigns  [x] = toInt(l_Undef);
+                    level    [x] = -1;
+                    trail_pos[x] = -1;
+                    free_vars.push(x);
+                }else
+                    trail_pos[x] = j, trail[j++] = trail[i];
+            }
+            trail.shrink(trail.size() - j);
+            qhead = trail.size();
+        }
+        released_vars.clear();
+    }
+
     simpDB_assigns = nAssigns();
     simpDB_props   = stats.clauses_literals + stats.learnts_literals;   // (shouldn't depend on 'stats' really, but it will do for now)
 }
@@ -677,7 +718,7 @@ lbool Solver::search(int nof_conflicts, int nof_learnts, const SearchParams& par
         }else{
             // NO CONFLICT
 
-            if (nof_conflicts >= 0 && conflictC >= nof_conflicts){
+            if ((nof_conflicts >= 0 && conflictC >= nof_conflicts) || !withinBudget()){
                 // Reached bound on number of conflicts:
                 progress_estimate = progressEstimate();
                 cancelUntil(root_level);
@@ -742,9 +783,23 @@ void Solver::claRescaleActivity()
 }
 
 
+// Reading the clock on every decision would dominate easy queries, so 'withinBudget()' only
+// calls this every few hundred conflicts or about a million propagations, whichever comes first.
+//
+bool Solver::withinDeadline()
+{
+    deadline_conflicts = stats.conflicts    + 256;
+    deadline_props     = stats.propagations + (1 << 20);
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0 < deadline_ms;
+}
+
+
 /*_________________________________________________________________________________________________
 |
-|  solve : (assumps : const vec<Lit>&)  ->  [bool]
+|  solveLimited : (assumps : const vec<Lit>&)  ->  [lbool]
 |  
 |  Description:
 |    Top-level solve. If using assumptions (non-empty 'assumps' vector), you must call
@@ -754,11 +809,19 @@ void Solver::claRescaleActivity()
 |  Input:
 |    A list of assumptions (unit clauses coded as literals). Pre-condition: The assumptions must
 |    not contain both 'x' and '~x' for any variable 'x'.
+|  
+|  Output:
+|    'l_True' if satisfiable, 'l_False' if unsatisfiable, 'l_Undef' if 'conflict_budget',
+|    'propagation_budget' or 'deadline_ms' ran out first. 'solve()' maps 'l_Undef' to false.
 |________________________________________________________________________________________________@*/
-bool Solver::solve(const vec<Lit>& assumps)
+lbool Solver::solveLimited(const vec<Lit>& assumps)
 {
     simplifyDB();
-    if (!ok) return false;
+    if (!ok) return l_False;
+
+    conflict_limit    = stats.conflicts    + conflict_budget;
+    propagation_limit = stats.propagations + propagation_budget;
+    deadline_conflicts = deadline_props = 0;    // (read the clock before the first decision)
 
     SearchParams    params(default_params);
     double  nof_conflicts = 100;
@@ -781,12 +844,12 @@ bool Solver::solve(const vec<Lit>& assumps)
                 if (proof != NULL) conflict_id = unit_id[var(p)];
             }
             cancelUntil(0);
-            return false; }
+            return l_False; }
         Clause* confl = propagate();
         if (confl != NULL){
             analyzeFinal(confl), assert(conflict.size() > 0);
             cancelUntil(0);
-            return false; }
+            return l_False; }
     }
     assert(root_level == decisionLevel());
 
@@ -802,7 +865,7 @@ bool Solver::solve(const vec<Lit>& assumps)
         reportf("===================================\n");
     }
 
-    while (status == l_Undef){
+    while (status == l_Undef && withinBudget()){
         if (verbosity >= 1){
             printStats();
             reportf("| %9d | %7d %8d | %7d %7d %8d %7.1f | %6.3f %% |\n",
@@ -824,7 +887,7 @@ bool Solver::solve(const vec<Lit>& assumps)
     }
 
     cancelUntil(0);
-    return status == l_True;
+    return status;
 }
 
 void Solver::printStats()
@@ -60,6 +60,7 @@ protected:
     vec<double>         activity;         // A heuristic measurement of the activity of a variable.
     double              var_inc;          // Amount to bump next variable with.
     double              var_decay;        // INVERSE decay factor for variable activity: stores 1/decay. Use negative value for static variable order.
+    vec<char>           decision;         // 'decision[var]' is FALSE if the variable is never branched on (its value must follow by propagation).
     VarOrder            order;            // Keeps track of the decision variable order.
 
     vec<vec<Clause*> >  watches;          // 'watches[lit]' is a list of constraints watching 'lit' (will go there if literal becomes true).
@@ -73,6 +74,12 @@ protected:
     int                 qhead;            // Head of queue (as index into the trail -- no more explicit propagation queue in MiniSat).
     int                 simpDB_assigns;   // Number of top-level assignments since last execution of 'simplifyDB()'.
     int64               simpDB_props;     // Remaining number of propagations that must be made before next execution of 'simplifyDB()'.
+    int64               conflict_limit;   // 'stats.conflicts' at which the current 'solveLimited()' gives up.
+    int64               propagation_limit;// 'stats.propagations' at which the current 'solveLimited()' gives up.
+    vec<Var>            released_vars;    // Vars handed to 'releaseVar()', freed by the next full 'simplifyDB()'.
+    vec<Var>            free_vars;        // Vars with no clauses left, reused by 'newVar()'.
+    int64               deadline_conflicts;// 'stats.conflicts' at which the clock is next read against 'deadline_ms'.
+    int64               deadline_props;   // 'stats.propagations' at which the clock is next read against 'deadline_ms'.
 
     // Temporaries (to reduce allocation overhead). Each variable is prefixed by the method in which is used:
     //
@@ -100,6 +107,13 @@ protected:
     Lit         pickBranchLit    (const SearchParams& params);
     lbool       search           (int nof_conflicts, int nof_learnts, const SearchParams& params);
     double      progressEstimate ();
+    bool        withinBudget     () {
+        if (!((conflict_budget    < 0 || stats.conflicts    < conflict_limit)
+           && (propagation_budget < 0 || stats.propagations < propagation_limit))) return false;
+        return deadline_ms <= 0
+            || (stats.conflicts < deadline_conflicts && stats.propagations < deadline_props)
+            || withinDeadline(); }
+    bool        withinDeadline   ();
 
     // Activity:
     //
@@ -128,14 +142,21 @@ public:
              , cla_decay        (1)
              , var_inc          (1)
              , var_decay        (1)
-             , order            (assigns, activity)
+             , order            (assigns, activity, decision)
              , qhead            (0)
              , simpDB_assigns   (0)
              , simpDB_props     (0)
+             , conflict_limit   (0)
+             , propagation_limit(0)
+             , deadline_conflicts(0)
+             , deadline_props   (0)
              , default_params   (SearchParams(0.95, 0.999, 0.02))
              , expensive_ccmin  (2)
              , proof            (NULL)
              , verbosity        (0)
+             , conflict_budget  (-1)
+             , propagation_budget(-1)
+             , deadline_ms      (0)
              , progress_estimate(0)
              , conflict_id      (ClauseId_NULL)
              {
@@ -175,10 +196,15 @@ public:
     int             expensive_ccmin;    // Controls conflict clause minimization. TRUE by default.
     Proof*          proof;              // Set this directly after constructing 'Solver' to enable proof logging. Initialized to NULL.
     int             verbosity;          // Verbosity level. 0=silent, 1=some progress report, 2=everything
+    int64           conflict_budget;    // Conflicts allowed per 'solveLimited()' call. Negative means no limit.
+    int64           propagation_budget; // Propagations allowed per 'solveLimited()' call. Negative means no limit.
+    double          deadline_ms;        // Wall clock (ms since the epoch) at which 'solveLimited()' gives up. 0 means no limit.
 
     // Problem specification:
     //
     Var     newVar    ();
+    void    releaseVar(Lit l);      // Assert 'l' and reuse its var once 'simplifyDB()' has removed its clauses.
+    void    setDecisionVar(Var v, bool b) { decision[v] = b; if (b) order.undo(v); }
     int     nVars     ()                    { return assigns.size(); }
     void    addUnit   (Lit p)               { addUnit_tmp   [0] = p; addClause(addUnit_tmp); }
     void    addBinary (Lit p, Lit q)        { addBinary_tmp [0] = p; addBinary_tmp [1] = q; addClause(addBinary_tmp); }
@@ -190,7 +216,8 @@ public:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    lbool   solveLimited(const vec<Lit>& assumps);     // 'l_Undef' if the budgets ran out.
+    bool    solve(const vec<Lit>& assumps) { return solveLimited(assumps) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
 
     double      progress_estimate;  // Set by 'search()'.
@@ -36,12 +36,13 @@ struct VarOrder_lt {
 class VarOrder {
     const vec<char>&    assigns;     // var->val. Pointer to external assignment table.
     const vec<double>&  activity;    // var->act. Pointer to external activity table.
+    const vec<char>&    decision;    // var->bool. Pointer to external decision flags.
     Heap<VarOrder_lt>   heap;
     double              random_seed; // For the internal random number generator
 
 public:
-    VarOrder(const vec<char>& ass, const vec<double>& act) :
-        assigns(ass), activity(act), heap(VarOrder_lt(act)), random_seed(91648253)
+    VarOrder(const vec<char>& ass, const vec<double>& act, const vec<char>& dec) :
+        assigns(ass), activity(act), decision(dec), heap(VarOrder_lt(act)), random_seed(91648253)
         { }
 
     inline void newVar(void);
@@ -67,7 +68,7 @@ void VarOrder::update(Var x)
 
 void VarOrder::undo(Var x)
 {
-    if (!heap.inHeap(x))
+    if (!heap.inHeap(x) && decision[x])
         heap.insert(x);
 }
 
@@ -77,14 +78,14 @@ Var VarOrder::select(double random_var_freq)
     // Random decision:
     if (drand(random_seed) < random_var_freq && !heap.empty()){
         Var next = irand(random_seed,assigns.size());
-        if (toLbool(assigns[next]) == l_Undef)
+        if (toLbool(assigns[next]) == l_Undef && decision[next])
             return next;
     }
 
     // Activity based decision:
     while (!heap.empty()){
         Var next = heap.getmin();
-        if (toLbool(assigns[next]) == l_Undef)
+        if (toLbool(assigns[next]) == l_Undef && decision[next])
             return next;
     }
 
@@ -20,7 +20,7 @@ class SatSolver
 {
    public : 
       SatSolver():_solver(0) { }
-      ~SatSolver() { }
+      ~SatSolver() { if (_solver) delete _solver; }
 
       // Solver initialization and reset
       void initialize() {
@@ -35,7 +35,14 @@ class SatSolver
 
       // Constructing proof model
       // Return the Var ID of the new Var
-      inline Var newVar() { _solver->newVar(); return _curVar++; }
+      inline Var newVar() { ++_curVar; return _solver->newVar(); }
+      // Assert var to val; the var is reused once its clauses are removed
+      void releaseVar(Var v, bool val) {
+         _solver->releaseVar(val? Lit(v): ~Lit(v));
+      }
+      // A non-decision var is never branched on; use it for vars that are
+      // functions of other vars (gate outputs)
+      void setDecisionVar(Var v, bool d) { _solver->setDecisionVar(v, d); }
       // fa/fb = true if it is inverted
       void addAigCNF(Var vf, Var va, bool fa, Var vb, bool fb) {
          vec<Lit> lits;
@@ -65,12 +72,46 @@ class SatSolver
          _solver->addClause(lits); lits.clear();
       }
 
+      // act -> (va != vb), fa/fb = true if it is inverted. release act
+      // false afterwards: the clauses become satisfied and are dropped
+      void addMiterCNF(Var act, Var va, bool fa, Var vb, bool fb) {
+         vec<Lit> lits;
+         Lit lt = Lit(act);
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         lits.push(~lt); lits.push( la); lits.push( lb);
+         _solver->addClause(lits); lits.clear();
+         lits.push(~lt); lits.push(~la); lits.push(~lb);
+         _solver->addClause(lits); lits.clear();
+      }
+
+      // va == vb, fa/fb = true if it is inverted
+      void addEqCNF(Var va, bool fa, Var vb, bool fb) {
+         vec<Lit> lits;
+         Lit la = fa? ~Lit(va): Lit(va);
+         Lit lb = fb? ~Lit(vb): Lit(vb);
+         lits.push(~la); lits.push( lb);
+         _solver->addClause(lits); lits.clear();
+         lits.push( la); lits.push(~lb);
+         _solver->addClause(lits); lits.clear();
+      }
+
       // For incremental proof, use "assumeSolve()"
       void assumeRelease() { _assump.clear(); }
       void assumeProperty(Var prop, bool val) {
          _assump.push(val? Lit(prop): ~Lit(prop));
       }
       bool assumpSolve() { return _solver->solve(_assump); }
+      // Return 1/0/-1 for SAT/UNSAT/budget exhausted
+      int assumpSolveLimited() {
+         lbool r = _solver->solveLimited(_assump);
+         return r==l_True? 1: (r==l_False? 0: -1); }
+      // Conflicts/propagations allowed per solve; negative means no limit
+      void setBudget(int64 conflicts, int64 propagations) {
+         _solver->conflict_budget = conflicts;
+         _solver->propagation_budget = propagations; }
+      // Wall clock (ms since the epoch) solves give up at; 0 means none
+      void setDeadline(double ms) { _solver->deadline_ms = ms; }
 
       // For one time proof, use "solve"
       void assertProperty(Var prop, bool val) {
@@ -198,9 +198,9 @@ public:
    // return true if inserted successfully (i.e. k is not in the hash)
    // return false is k is already in the hash ==> still do the insertion
    bool replaceInsert(const HashKey& k, const HashData& d) {
-      vector<HashNode> *b = _buckets[bucketNum(k)];
-      for(int i = b->size()-1; i >= 0; --i) {
-         HashNode &node = b->at(i);
+      vector<HashNode> &b = _buckets[bucketNum(k)];
+      for(int i = b.size()-1; i >= 0; --i) {
+         HashNode &node = b.at(i);
          if(node.first == k) {
             node.second = d;
             return false;